@@ -20,6 +20,8 @@ this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "commands.h"
 #include "formats/formats.h"
+#include "formats/listing.h"
+#include "formats/entry_filter.h"
 #include "disk/disk.h"
 
 #include <path.hpp>
@@ -69,9 +71,26 @@ void RunConvertCommand(std::string &input, std::string &output, std::string
 
 
 
+// Convert type/creator codes given in argument.
+static std::vector<uint32_t> ParseCodes(const std::vector<std::string> &strs,
+    const char *what)
+{
+    std::vector<uint32_t> codes;
+
+    for (auto &str : strs) {
+        uint32_t code;
+        if (!ParseFourCharCode(str, code))
+            StopOnError("%s '%s' is longer than 4 chars", what, str.c_str());
+        codes.push_back(code);
+    }
+
+    return codes;
+}
+
+
 // Run extract "e" command.
 void RunExtractCommand(std::string &input, std::string &output, std::string
-    &res_format)
+    &res_format, int jobs, FilterOptions &filter)
 {
     // Read input path given in argument.
     if (!Path(input).is_file())
@@ -82,6 +101,17 @@ void RunExtractCommand(std::string &input, std::string &output, std::string
     if (prefered_conv.type == ConvData::NotFound)
         StopOnError("format '%s' doesn't exist", res_format.c_str());
 
+    // Number of threads for extracting archives.
+    if (jobs < 1)
+        StopOnError("number of jobs must be at least 1");
+    num_jobs = jobs;
+
+    // Select files to extract.
+    entry_filter.include = filter.include;
+    entry_filter.exclude = filter.exclude;
+    entry_filter.types = ParseCodes(filter.types, "type");
+    entry_filter.creators = ParseCodes(filter.creators, "creator");
+
     // Unpack and extract the input file.
     auto u = UnPackLocalFile(input);
     if (!ExtractArchiveOrDisk(u, output))
@@ -90,6 +120,23 @@ void RunExtractCommand(std::string &input, std::string &output, std::string
 
 
 
+// Run list "l" command.
+void RunListCommand(std::string &input, bool json)
+{
+    // Read input path given in argument.
+    if (!Path(input).is_file())
+        StopOnError("input file doesn't exist");
+
+    list_format = json ? ListFormat::Json : ListFormat::Text;
+
+    // Unpack the input file and list its content (only headers are read).
+    auto u = UnPackLocalFile(input);
+    if (!ListArchiveOrDisk(u))
+        StopOnError("can't list input file (unsupported format)");
+}
+
+
+
 // Run disk creation "d" command.
 void RunDiskCommand(std::string &folder, std::string &output, std::string
     &name)
@@ -21,6 +21,7 @@ this program.  If not, see <https://www.gnu.org/licenses/>.
 #pragma once
 
 #include <string>
+#include <vector>
 
 namespace maconv {
 
@@ -36,13 +37,26 @@ extern "C" void LogDebug(const char *fmt, ...);
 extern "C" void StopOnError(const char *fmt, ...);
 
 
+// Filters given to the extract "e" command.
+struct FilterOptions {
+    std::vector<std::string> include; // Globs of files to extract.
+    std::vector<std::string> exclude; // Globs of files to skip.
+    std::vector<std::string> types; // Types of files to extract.
+    std::vector<std::string> creators; // Creators of files to extract.
+};
+
+
+
 // Run convert "c" command.
 void RunConvertCommand(std::string &input, std::string &output,
     std::string &format);
 
 // Run extract "e" command.
 void RunExtractCommand(std::string &input, std::string &output,
-    std::string &res_format);
+    std::string &res_format, int jobs, FilterOptions &filter);
+
+// Run list "l" command.
+void RunListCommand(std::string &input, bool json);
 
 // Run disk creation "d" command.
 void RunDiskCommand(std::string &folder, std::string &output,
@@ -82,9 +82,9 @@ bool ReadAppleDouble(fs::FileReader &reader, UnPacked &u)
     // If the file given it's a not a ressource file: read the res.
     if (!IsFileRessource(reader.filename)) {
         IS_COND(GetRessourceFile(u.n2));
-        int size = ReadLocalFile(u.n2, u.d2);
+        IS_COND(ReadLocalFile(u.n2, u.d2));
 
-        fs::FileReader res_reader {u.d2.get(), size, u.n2};
+        fs::FileReader res_reader {u.d2.data, u.d2.size, u.n2};
         IS_COND(IsAppleDouble(res_reader));
 
         ReadRessourceInfo(res_reader, u.file);
@@ -96,10 +96,9 @@ bool ReadAppleDouble(fs::FileReader &reader, UnPacked &u)
         IS_COND(IsAppleDouble(reader));
         ReadRessourceInfo(reader, u.file);
 
-        if (!GetDataFile(u.n2)) return true;
-        int size = ReadLocalFile(u.n2, u.d2);
+        if (!GetDataFile(u.n2) || !ReadLocalFile(u.n2, u.d2)) return true;
 
-        fs::FileReader data_reader {u.d2.get(), size, u.n2};
+        fs::FileReader data_reader {u.d2.data, u.d2.size, u.n2};
         ReadDataFork(data_reader, u.file);
     }
 
@@ -50,12 +50,14 @@ void ExtractAppleSimpleEntry(fs::FileReader &reader, fs::File &file, uint32_t id
         case 1: {
             file.data = reader.data + reader.Tell();
             file.data_size = length;
+            reader.Skip(length);
         } break;
 
         // Ressource fork.
         case 2: {
             file.res = reader.data + reader.Tell();
             file.res_size = length;
+            reader.Skip(length);
         } break;
 
         // Ressource fork.
@@ -165,10 +167,10 @@ void WriteAppleSingle(fs::File &file, fs::FileWriter &writer)
     writer.Fill(0x0, 22);
 
     // Write data fork.
-    writer.Write(file.data, file.data_size);
+    writer.WriteFork(file, false);
 
     // Wrire ressource fork.
-    writer.Write(file.res, file.res_size);
+    writer.WriteFork(file, true);
 }
 
 
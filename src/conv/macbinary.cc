@@ -139,6 +139,10 @@ void ReadMacBinary(fs::FileReader &reader, fs::File &file)
     // Set data and resource forks.
     file.data = reader.data + 128;
     file.res = reader.data + 128 + ((file.data_size + 127) & -128);
+
+    // Make sure that both forks are inside the file.
+    reader.Seek(128 + ((file.data_size + 127) & -128));
+    reader.Skip(file.res_size);
 }
 
 
@@ -191,11 +195,11 @@ void WriteMacBinary(fs::File &file, fs::FileWriter &base)
 
     // Write data fork.
     base.Fill(0x0, 2);
-    base.Write(file.data, file.data_size);
+    base.WriteFork(file, false);
 
     // Write ressource fork.
     base.Fill(0x7F, ((file.data_size + 127) & -128) - file.data_size);
-    base.Write(file.res, file.res_size);
+    base.WriteFork(file, true);
 
     // Write remaning padding.
     base.Fill(0x7F, ((file.res_size + 127) & -128) - file.res_size);
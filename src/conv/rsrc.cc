@@ -45,14 +45,16 @@ static bool GetOtherName(const std::string &input, std::string &other)
 // Read "rsrc" from two files (data and ressource).
 static void ReadRsrcDouble(UnPacked &u, const std::string &other, bool is_res)
 {
-    uint32_t size = ReadLocalFile(other, u.d2);
+    if (!ReadLocalFile(other, u.d2))
+        return;
+    u.d2.Advise(fs::Access::Sequential);
 
     if (is_res) {
-        u.file.data = u.d2.get();
-        u.file.data_size = size;
+        u.file.data = u.d2.data;
+        u.file.data_size = u.d2.size;
     } else {
-        u.file.res = u.d2.get();
-        u.file.res_size = size;
+        u.file.res = u.d2.data;
+        u.file.res_size = u.d2.size;
     }
 }
 
@@ -74,16 +76,15 @@ bool ReadRsrc(fs::FileReader &reader, UnPacked &u)
     // Set input fork size.
     if (is_res) {
         u.file.filename = Path(other).filename();
-        u.file.res = u.d1.get();
+        u.file.res = u.d1.data;
         u.file.res_size = reader.file_size;
     } else {
         u.file.filename = Path(reader.filename).filename();
-        u.file.data = u.d1.get();
+        u.file.data = u.d1.data;
         u.file.data_size = reader.file_size;
     }
 
     // Find file information from the local file.
-    u.file.is_raw = true;
     GetLocalInfo(is_double && is_res ? other : reader.filename, u.file);
     return true;
 }
@@ -91,15 +92,15 @@ bool ReadRsrc(fs::FileReader &reader, UnPacked &u)
 
 
 // Write a single fork into a file.
-static void WriteFork(fs::File &file, const std::string &name, uint8_t *data,
-    uint32_t length)
+static void WriteFork(fs::File &file, const std::string &name, bool is_res)
 {
     std::ofstream fstream {name, std::ios::binary};
+    fs::FileWriter writer {fstream};
 
-    fstream.write(reinterpret_cast<char *>(data), length);
+    writer.WriteFork(file, is_res);
     fstream.close();
 
-    SetLocalInfo(file, name, file.res == data);
+    SetLocalInfo(file, name, is_res);
 }
 
 
@@ -112,9 +113,9 @@ void WriteRsrc(fs::File &file, const std::string &name)
 
     // Write forks (write only if size is > 0).
     if (file.data_size)
-        WriteFork(file, is_res ? other : name, file.data, file.data_size);
+        WriteFork(file, is_res ? other : name, false);
     if (file.res_size)
-        WriteFork(file, is_res ? name : other, file.res, file.res_size);
+        WriteFork(file, is_res ? name : other, true);
 }
 
 
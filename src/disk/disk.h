@@ -24,16 +24,44 @@ this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "fs/file_reader.h"
 #include "formats/formats.h"
 
+// Mounted HFS volume (from libhfs/hfs.h, which can't be included twice).
+typedef struct _hfsvol_ hfsvol;
+
 namespace maconv {
 namespace disk {
 
 
+// Size of the HFS block cache in KB (libhfs default if -1, no cache if 0).
+extern long cache_size;
+
+
 // Is a file a disk file?
 bool IsFileDisk(const std::string &name);
 
+// Is a file a raw HFS disk image?
+bool IsFileHfsDisk(fs::FileReader &reader);
+
+// Is a file a DiskCopy 4.2 image?
+bool IsFileDiskCopy(fs::FileReader &reader);
+
+// Unpack a DiskCopy 4.2 image (keep only the disk data).
+void UnPackDiskCopy(fs::FileReader &reader, fs::File &file);
+
+
 // Extract a disk file.
 void ExtractDisk(UnPacked &u, const std::string &out_folder);
 
+// List the content of a disk file.
+void ListDisk(UnPacked &u);
+
+
+// Set the size of the block cache of the next mounted volumes (if asked by
+// the user).
+void SetupCache();
+
+// Unmount a volume (and log statistics of its block cache).
+void UnmountDisk(hfsvol *vol);
+
 
 // Pack files into a single disk image.
 void PackDiskImage(const std::string &folder, const std::string &out,
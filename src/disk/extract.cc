@@ -20,18 +20,69 @@ this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "disk/disk.h"
 #include "commands.h"
+#include "formats/listing.h"
+#include "formats/entry_filter.h"
 
 #include <libhfs/hfs.h>
 #include <libhfs/data.h>
 
 #include <make_unique.hpp>
 #include <path.hpp>
-#include <cstdio>
+#include <cerrno>
+#include <unordered_map>
+#include <vector>
 
 namespace maconv {
 namespace disk {
 
 
+// Size of the header of DiskCopy 4.2 images.
+constexpr uint32_t kDiskCopyHeaderSize = 84;
+
+// Size of the HFS block cache in KB (libhfs default if -1, no cache if 0).
+long cache_size = -1;
+
+
+// Entry of a disk catalog.
+struct CatalogEntry {
+    hfsdirent ent; // Information about the file or directory.
+    hfscatrec rec; // Catalog record of the file (to open it without lookup).
+};
+
+// Catalog of a disk: entries grouped by CNID of their parent directory.
+using Catalog = std::unordered_map<unsigned long, std::vector<CatalogEntry>>;
+
+
+
+// Read the whole catalog in a single pass over the B-tree leaves. If
+// |keep_records| is set, the catalog record of each file is saved so that
+// it can be opened later without being looked up by name.
+static Catalog ReadCatalog(hfsvol *vol, bool keep_records)
+{
+    Catalog catalog;
+
+    hfsdir *dir = hfs_opencat(vol);
+    if (dir == nullptr)
+        StopOnError("can't read HFS catalog (%s)", hfs_error ? hfs_error : "unknown error");
+
+    CatalogEntry entry;
+
+    while (hfs_readdir(dir, &entry.ent) != -1) {
+        bool is_file = !(entry.ent.flags & HFS_ISDIR);
+        if (keep_records && is_file && hfs_getcatrec(dir, &entry.rec) == -1)
+            StopOnError("can't read HFS catalog (%s)", hfs_error ? hfs_error : "unknown error");
+
+        catalog[entry.ent.parid].push_back(entry);
+    }
+
+    if (errno != ENOENT)
+        StopOnError("can't read HFS catalog (%s)", hfs_error ? hfs_error : "unknown error");
+
+    hfs_closedir(dir);
+    return catalog;
+}
+
+
 
 // Extract a single fork.
 static void ExtractFork(hfsfile *hfile, const hfsdirent &ent, fs::File &file,
@@ -61,8 +112,10 @@ static void ExtractFork(hfsfile *hfile, const hfsdirent &ent, fs::File &file,
 
 
 // Extract a file from a disk.
-static void ExtractFile(Path &localp, hfsvol *vol, const hfsdirent &ent)
+static void ExtractFile(Path &localp, hfsvol *vol, const CatalogEntry &entry)
 {
+    auto &ent = entry.ent;
+
     Path::makedirs(localp);
     fs::File file;
 
@@ -75,8 +128,11 @@ static void ExtractFile(Path &localp, hfsvol *vol, const hfsdirent &ent)
     file.creation_date = ent.crdate;
     file.modif_date = ent.mddate;
 
-    // Extract the two forks.
-    hfsfile *hfile = hfs_open(vol, ent.name);
+    // Extract the two forks (the file is opened from its catalog record).
+    hfsfile *hfile = hfs_openrec(vol, &entry.rec);
+    if (hfile == nullptr)
+        StopOnError("can't open %s from HFS disk", file.filename.c_str());
+
     ExtractFork(hfile, ent, file, false);
     ExtractFork(hfile, ent, file, true);
     hfs_close(hfile);
@@ -88,58 +144,126 @@ static void ExtractFile(Path &localp, hfsvol *vol, const hfsdirent &ent)
 
 
 
-// Extract a directory from the disk.
-static void ExtractDirectory(Path localp, hfsvol *vol, unsigned long id)
+// Is a file selected by the extraction filter?
+static bool IsFileSelected(const std::string &path, const hfsdirent &ent)
 {
-    unsigned long current = hfs_getcwd(vol);
-    hfs_setcwd(vol, id);
+    if (entry_filter.IsEmpty())
+        return true;
 
-    hfsdir *dir = hfs_opendir(vol, ":");
-    hfsdirent ent;
+    uint32_t type = d_getsl((const unsigned char *)ent.u.file.type);
+    uint32_t creator = d_getsl((const unsigned char *)ent.u.file.creator);
+    return entry_filter.Match(path, type, creator);
+}
 
-    while (hfs_readdir(dir, &ent) != -1) {
+
+// Extract a directory from the disk.
+// |path| is the path of the directory on the disk (used for filtering files).
+static void ExtractDirectory(Path localp, const std::string &path,
+    hfsvol *vol, Catalog &catalog, unsigned long id)
+{
+    for (auto &entry : catalog[id]) {
+        auto &ent = entry.ent;
         if (ent.fdflags & HFS_FNDR_ISINVISIBLE)
             continue;
 
+        std::string entpath = path.empty() ? ent.name : path + "/" + ent.name;
+
         if (ent.flags & HFS_ISDIR)
-            ExtractDirectory(Path::join(localp, ent.name), vol, ent.cnid);
-        else
-	        ExtractFile(localp, vol, ent);
+            ExtractDirectory(Path::join(localp, ent.name), entpath, vol, catalog, ent.cnid);
+        else if (IsFileSelected(entpath, ent))
+            ExtractFile(localp, vol, entry);
     }
+}
 
-    hfs_closedir(dir);
-    hfs_setcwd(vol, current);
+
+
+// Mount the disk image from the data fork (read only). The data stays in
+// memory (mapped for local files), so the image is never copied to a file.
+static hfsvol *MountDisk(UnPacked &u)
+{
+    SetupCache();
+
+    hfsvol *vol = hfs_mountmem(u.file.data, u.file.data_size, 0);
+    if (vol == nullptr)
+        StopOnError("can't mount HFS disk (%s)", hfs_error ? hfs_error : "unknown error");
+
+    return vol;
 }
 
 
+// Set the size of the block cache of the next mounted volumes (if asked by
+// the user), so that it is created once with the right size.
+void SetupCache()
+{
+    if (cache_size >= 0)
+        hfs_setdefcache(cache_size * (1024 / HFS_BLOCKSZ));
+}
+
 
-// Extract a disk file.
-static void ExtractDiskFrom(const std::string &name, const std::string &out)
+// Unmount a volume (and log statistics of its block cache).
+void UnmountDisk(hfsvol *vol)
 {
-    hfsvol *vol = hfs_mount(name.c_str(), 0, HFS_MODE_RDONLY);
-    ExtractDirectory(out, vol, HFS_CNID_ROOTDIR);
+    hfscachestat stat;
+
+    if (hfs_cachestat(vol, &stat) == 0 && stat.size != 0)
+        LogDebug("HFS cache: %lu KB, %lu hits, %lu misses",
+            stat.size / (1024 / HFS_BLOCKSZ), stat.hits, stat.misses);
+
     hfs_umount(vol);
 }
 
 
+
 // Extract a disk file.
 void ExtractDisk(UnPacked &u, const std::string &out_folder)
 {
-    // If it's not a "raw" file: extract the file directly.
-    if (u.file.is_raw)
-        ExtractDiskFrom(u.n1, out_folder);
+    hfsvol *vol = MountDisk(u);
+    auto catalog = ReadCatalog(vol, true);
+    ExtractDirectory(out_folder, "", vol, catalog, HFS_CNID_ROOTDIR);
+    UnmountDisk(vol);
+}
+
+
+
+// List the entries of a directory from the disk.
+static void ListDirectory(const std::string &path, Catalog &catalog,
+    unsigned long id)
+{
+    for (auto &entry : catalog[id]) {
+        auto &ent = entry.ent;
+        if (ent.fdflags & HFS_FNDR_ISINVISIBLE)
+            continue;
 
-    // Else, save the data fork to a temporary file first and then extract.
-    char dirname[] = "/tmp/maconv.XXXXXX";
-    if (mkdtemp(dirname) == nullptr)
-        StopOnError("can't create temporary folder for HFS disk");
+        ListEntry lent;
+        lent.path = path.empty() ? ent.name : path + "/" + ent.name;
+        lent.is_dir = (ent.flags & HFS_ISDIR);
+        lent.flags = ent.fdflags;
+        lent.creation_date = ent.crdate;
+        lent.modif_date = ent.mddate;
+
+        // HFS forks are never compressed.
+        if (!lent.is_dir) {
+            lent.type = d_getsl((const unsigned char *)ent.u.file.type);
+            lent.creator = d_getsl((const unsigned char *)ent.u.file.creator);
+            lent.data = ListFork {(uint32_t)ent.u.file.dsize, (uint32_t)ent.u.file.dsize, ""};
+            lent.res = ListFork {(uint32_t)ent.u.file.rsize, (uint32_t)ent.u.file.rsize, ""};
+        }
+
+        PrintListEntry(lent);
+        if (lent.is_dir)
+            ListDirectory(lent.path, catalog, ent.cnid);
+    }
+}
 
-    std::string name = std::string {dirname} + "/disk.dsk";
-    PackLocalFile(u.file, name, GetConverter("data"));
-    ExtractDiskFrom(name, out_folder);
 
-    std::remove(name.c_str());
-    rmdir(dirname);
+// List the content of a disk file (only the catalog is read).
+void ListDisk(UnPacked &u)
+{
+    hfsvol *vol = MountDisk(u);
+    auto catalog = ReadCatalog(vol, false);
+    PrintListHeader();
+    ListDirectory("", catalog, HFS_CNID_ROOTDIR);
+    UnmountDisk(vol);
 }
 
 
@@ -153,5 +277,61 @@ bool IsFileDisk(const std::string &name)
 
 
 
+// Is a file a raw HFS disk image? Its Master Directory Block must be sane.
+bool IsFileHfsDisk(fs::FileReader &reader)
+{
+    IS_COND(reader.file_size >= 1024 + 512);
+
+    reader.Seek(1024);
+    IS_COND(reader.ReadHalfBE() == 0x4244); // "BD"
+
+    reader.Seek(1024 + 18);
+    uint16_t num_blocks = reader.ReadHalfBE();
+    uint32_t block_size = reader.ReadWordBE();
+    IS_COND(num_blocks > 0 && block_size > 0 && block_size % 512 == 0);
+
+    // Allocation blocks start after the MDB and must fit in the file.
+    reader.Seek(1024 + 28);
+    uint16_t first_block = reader.ReadHalfBE();
+    uint64_t end = (uint64_t)first_block * 512 + (uint64_t)num_blocks * block_size;
+    IS_COND(first_block >= 3 && end <= reader.file_size);
+
+    return true;
+}
+
+
+// Is a file a DiskCopy 4.2 image?
+bool IsFileDiskCopy(fs::FileReader &reader)
+{
+    reader.Seek(0);
+    IS_COND(reader.file_size >= kDiskCopyHeaderSize);
+    IS_COND(reader.ReadByte() < 64); // Length of the disk name.
+
+    reader.Seek(0x40);
+    uint32_t data_size = reader.ReadWordBE();
+    uint32_t tag_size = reader.ReadWordBE();
+    IS_COND(data_size > 0 && data_size % 512 == 0);
+
+    // Sizes are checked one at a time so their sum can't wrap.
+    uint32_t avail = reader.file_size - kDiskCopyHeaderSize;
+    IS_COND(data_size <= avail && tag_size <= avail - data_size);
+
+    reader.Seek(0x52);
+    IS_COND(reader.ReadHalfBE() == 0x0100);
+
+    return true;
+}
+
+
+// Unpack a DiskCopy 4.2 image (keep only the disk data).
+void UnPackDiskCopy(fs::FileReader &reader, fs::File &file)
+{
+    reader.Seek(0x40);
+    file.data = reader.data + kDiskCopyHeaderSize;
+    file.data_size = reader.ReadWordBE();
+}
+
+
+
 } // namespace disk
 } // namespace maconv
@@ -147,6 +147,8 @@ static hfsvol *CreateAndMountNewDisk(const std::string &filename,
     if (hfs_format(filename.c_str(), 0, 0, clean_name.c_str(), 0, NULL) != 0)
         StopOnError("can't format disk file to HFS");
 
+    SetupCache();
+
     hfsvol *vol = hfs_mount(filename.c_str(), 0, HFS_MODE_RDWR);
     if (vol == nullptr)
         StopOnError("can't mount output disk image");
@@ -161,7 +163,7 @@ void PackDiskImage(const std::string &folder, const std::string &out,
 {
     hfsvol *vol = CreateAndMountNewDisk(out, volname);
     PackDirectory(folder, vol);
-    hfs_umount(vol);
+    UnmountDisk(vol);
 }
 
 
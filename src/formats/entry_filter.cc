@@ -0,0 +1,104 @@
+/*
+
+Select which entries of an archive or a disk are extracted.
+
+Copyright (C) 2019, Guillaume Gonnet
+
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "formats/entry_filter.h"
+
+#include <algorithm>
+#include <fnmatch.h>
+
+namespace maconv {
+
+
+// Filter on the files to extract.
+EntryFilter entry_filter;
+
+
+
+// Does a glob match a file path?
+static bool MatchGlob(const std::string &glob, const std::string &path)
+{
+    // Globs without '/' are matched against the file name only.
+    std::string name = path;
+    if (glob.find('/') == std::string::npos) {
+        size_t slash = path.rfind('/');
+        if (slash != std::string::npos)
+            name = path.substr(slash + 1);
+    }
+
+    return fnmatch(glob.c_str(), name.c_str(), 0) == 0;
+}
+
+
+// Does a glob in |globs| match a file path?
+static bool MatchAnyGlob(const std::vector<std::string> &globs,
+    const std::string &path)
+{
+    return std::any_of(globs.begin(), globs.end(), [&path](const std::string &glob) {
+        return MatchGlob(glob, path);
+    });
+}
+
+
+// Is |code| in |codes|?
+static bool HasCode(const std::vector<uint32_t> &codes, uint32_t code)
+{
+    return std::find(codes.begin(), codes.end(), code) != codes.end();
+}
+
+
+
+// Is the filter empty (i.e. every file is selected)?
+bool EntryFilter::IsEmpty() const
+{
+    return include.empty() && exclude.empty() && types.empty() && creators.empty();
+}
+
+
+// Is a file selected by the filter?
+bool EntryFilter::Match(const std::string &path, uint32_t type, uint32_t creator) const
+{
+    if (!types.empty() && !HasCode(types, type))
+        return false;
+    if (!creators.empty() && !HasCode(creators, creator))
+        return false;
+
+    if (!include.empty() && !MatchAnyGlob(include, path))
+        return false;
+    return !MatchAnyGlob(exclude, path);
+}
+
+
+
+// Convert a string to a 4 chars code (padded with spaces).
+// Return false if the string is longer than 4 chars.
+bool ParseFourCharCode(const std::string &str, uint32_t &code)
+{
+    if (str.size() > 4)
+        return false;
+
+    code = 0;
+    for (size_t i = 0; i < 4; i++)
+        code = (code << 8) | static_cast<uint8_t>(i < str.size() ? str[i] : ' ');
+
+    return true;
+}
+
+
+} // namespace maconv
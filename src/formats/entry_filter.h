@@ -0,0 +1,60 @@
+/*
+
+Select which entries of an archive or a disk are extracted.
+
+Copyright (C) 2019, Guillaume Gonnet
+
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <inttypes.h>
+
+namespace maconv {
+
+
+// Filter on the files to extract (an empty filter selects everything).
+// A glob without '/' is matched against the file name, other globs are
+// matched against the path of the file (relative to the archive root).
+struct EntryFilter {
+
+    // Is the filter empty (i.e. every file is selected)?
+    bool IsEmpty() const;
+
+    // Is a file selected by the filter?
+    bool Match(const std::string &path, uint32_t type, uint32_t creator) const;
+
+
+    std::vector<std::string> include; // Extract only files matching these globs.
+    std::vector<std::string> exclude; // Don't extract files matching these globs.
+
+    std::vector<uint32_t> types; // Extract only files with these types.
+    std::vector<uint32_t> creators; // Extract only files with these creators.
+};
+
+
+
+// Filter on the files to extract.
+extern EntryFilter entry_filter;
+
+
+// Convert a string to a 4 chars code (padded with spaces).
+// Return false if the string is longer than 4 chars.
+bool ParseFourCharCode(const std::string &str, uint32_t &code);
+
+
+} // namespace maconv
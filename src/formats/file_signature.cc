@@ -20,38 +20,58 @@ this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "formats/file_signature.h"
 
-#include <memory>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <vector>
 
 namespace maconv {
 namespace utils {
 
 
+// Types of the helps given to entries.
+using ExtensionHelp = const char *;
+using MagicHelp = MagicBytes;
+
 // Create a new entry in the "Unix-to-Mac" array.
 #define S(type, creator, mac, helps...) \
-    SignToMac(SignToMac::type, creator, mac, (const char *[])helps, \
-        sizeof((const char *[])helps) / sizeof(const char *))
+    SignToMac(creator, mac, (const type##Help[])helps, \
+        sizeof((const type##Help[])helps) / sizeof(type##Help))
+
+// Bytes at a given offset (for "Magic" entries).
+#define B(offset, bytes) MagicBytes { offset, bytes, sizeof(bytes) - 1 }
 
 
 // File signature array.
+// When several entries match a file, the first one is selected.
 SignToMac signs_to_mac[] = {
     S(Extension, "TVOD", "Mp3 ", { ".mp3" }),
-    S(FileCmd,   "TVOD", "Midi", { "Standard MIDI" }),
-    S(FileCmd,   "TVOD", "WAVE", { "WAVE audio" }),
+    S(Magic,     "TVOD", "Mp3 ", { B(0, "ID3") }),
+    S(Magic,     "TVOD", "Midi", { B(0, "MThd") }),
+    S(Magic,     "TVOD", "WAVE", { B(0, "RIFF"), B(8, "WAVE") }),
+    S(Magic,     "TVOD", "AIFF", { B(0, "FORM"), B(8, "AIFF") }),
+
+    S(Magic,     "CARO", "PDF ", { B(0, "%PDF-") }),
+    S(Extension, "PPT3", "PPT3", { ".ppt", ".pptx" }),
+    S(Extension, "MSWD", "W8BN", { ".doc", ".docx" }),
+    S(Extension, "XCEL", "XLS ", { ".xls", ".xlsx" }),
 
-    S(FileCmd,   "CARO", "PDF ", { "PDF document" }),
-    S(FileCmd,   "ZIP ", "ZIP ", { "Zip archive data" }),
+    S(Magic,     "ZIP ", "ZIP ", { B(0, "PK\x03\x04") }),
+    S(Magic,     "Gzip", "Gzip", { B(0, "\x1f\x8b") }),
     S(Extension, "Gzip", "Gzip", { ".tar.gz", ".tgz" }),
-    S(FileCmd,   "TARF", "TARF", { "tar archive" }),
+    S(Magic,     "TARF", "TARF", { B(257, "ustar") }),
+    S(Magic,     "SIT!", "SIT!", { B(0, "SIT!"), B(10, "rLau") }),
+    S(Magic,     "SIT!", "SITD", { B(0, "StuffIt (c)1997-") }),
 
-    S(FileCmd,   "8BIM", "JPEG", { "JPEG image data" }),
-    S(FileCmd,   "8BIM", "PNGf", { "PNG image data" }),
-    S(FileCmd,   "8BIM", "BMPf", { "PC bitmap" }),
-    S(FileCmd,   "8BIM", "TIFF", { "TIFF image data" }),
-    S(FileCmd,   "8BIM", "GIFf", { "GIF image data" }),
+    S(Magic,     "8BIM", "JPEG", { B(0, "\xff\xd8\xff") }),
+    S(Magic,     "8BIM", "PNGf", { B(0, "\x89PNG\r\n\x1a\n") }),
+    S(Magic,     "8BIM", "BMPf", { B(0, "BM"), B(6, "\0\0\0\0") }),
+    S(Magic,     "8BIM", "TIFF", { B(0, "II*\0") }),
+    S(Magic,     "8BIM", "TIFF", { B(0, "MM\0*") }),
+    S(Magic,     "8BIM", "GIFf", { B(0, "GIF87a") }),
+    S(Magic,     "8BIM", "GIFf", { B(0, "GIF89a") }),
 
-    S(Extension, "PPT3", "PPT3", { ".ppt", ".pptx" }),
-    S(Extension, "MSWD", "W8BN", { ".doc", ".docs" }),
-    S(Extension, "XCEL", "XLS ", { ".xls", ".xlsx" }),
+    S(Extension, "ttxt", "TEXT", { ".txt" }),
 
     // Else: UNKN, TEXT
 };
@@ -65,30 +85,110 @@ SignToUnix signs_to_unix[] = {
 
 
 
-// Call Unix "file" command on a path.
-static std::string CallFileCommand(const std::string &path)
-{
-    using PosixPtr = std::unique_ptr<FILE, decltype(&pclose)>;
+// A node of the magic trie. Each edge tests a byte at an offset of the
+// file; an entry matches when all the edges leading to its node match.
+struct MagicNode {
+
+    // An edge to a child node.
+    struct Edge {
+        uint32_t offset; // Offset of the byte to test.
+        uint8_t byte; // Expected byte.
+        uint32_t child; // Index of the child node.
+    };
+
+    std::vector<Edge> edges; // Edges to children nodes.
+    int entry = -1; // Entry matching at this node (-1 if none).
+};
+
 
-    auto cmd = std::string {"file -d "} + path;
-    PosixPtr pipe {popen(cmd.c_str(), "r"), pclose};
-    if (!pipe)
-        return nullptr;
+// Trie compiled from all "Magic" entries of |signs_to_mac|.
+struct MagicTrie {
 
-    std::array<char, 128> buffer;
-    std::string result;
+    // Compile the trie from |signs_to_mac|.
+    MagicTrie();
 
-    while (fgets(buffer.data(), buffer.size(), pipe.get()) != nullptr)
-        result += buffer.data();
+    // Add the magic bytes of an entry to the trie.
+    void Add(const SignToMac &entry, int index);
 
-    return result;
+    // Find the first entry whose magic bytes match |data| (-1 if none).
+    int Match(const uint8_t *data, uint32_t size) const;
+
+
+    std::vector<MagicNode> nodes; // Nodes of the trie (the root is nodes[0]).
+};
+
+
+
+// Compile the trie from |signs_to_mac|.
+MagicTrie::MagicTrie()
+    : nodes(1)
+{
+    int index = 0;
+    for (auto const &entry : signs_to_mac) {
+        if (entry.type == SignToMac::Magic)
+            Add(entry, index);
+        index++;
+    }
 }
 
 
+// Add the magic bytes of an entry to the trie.
+void MagicTrie::Add(const SignToMac &entry, int index)
+{
+    // Tests are sorted by offset so that entries share their prefixes.
+    std::vector<std::pair<uint32_t, uint8_t>> tests;
+    for (int i = 0; i < entry.magic_len; i++) {
+        auto &magic = entry.magic[i];
+        for (uint32_t j = 0; j < magic.len; j++)
+            tests.emplace_back(magic.offset + j, magic.bytes[j]);
+    }
+    std::sort(tests.begin(), tests.end());
+
+    // Walk the trie (and create missing nodes).
+    uint32_t node = 0;
+    for (auto &test : tests) {
+        auto &edges = nodes[node].edges;
+        auto edge = std::find_if(edges.begin(), edges.end(), [&test](const MagicNode::Edge &e) {
+            return e.offset == test.first && e.byte == test.second;
+        });
+
+        if (edge != edges.end()) {
+            node = edge->child;
+        } else {
+            edges.push_back({ test.first, test.second, (uint32_t)nodes.size() });
+            node = nodes.size();
+            nodes.emplace_back();
+        }
+    }
+
+    if (nodes[node].entry == -1)
+        nodes[node].entry = index;
+}
+
+
+// Find the first entry whose magic bytes match |data| (-1 if none).
+int MagicTrie::Match(const uint8_t *data, uint32_t size) const
+{
+    int best = -1;
+    std::vector<uint32_t> stack {0};
+
+    // Visit all nodes whose edges match (several entries may match).
+    while (!stack.empty()) {
+        auto &node = nodes[stack.back()];
+        stack.pop_back();
+
+        if (node.entry != -1 && (best == -1 || node.entry < best))
+            best = node.entry;
+
+        for (auto &edge : node.edges) {
+            if (edge.offset < size && data[edge.offset] == edge.byte)
+                stack.push_back(edge.child);
+        }
+    }
+
+    return best;
+}
 
-// Try matching a file with an entry.
-#define MAC_MATCH(type, func, entry, help) \
-    case SignToMac::type: if (func(entry, help)) return &entry; break
 
 
 // Try matching a path with the given entry.
@@ -107,31 +207,25 @@ static bool UnixMatchExtension(const SignToMac &entry, const std::string &path)
 }
 
 
-// Try matching a "file" cmd output with the given entry.
-static bool UnixMatchFileCmd(const SignToMac &entry, const std::string &output)
-{
-    for (int i = 0; i < entry.help_len; i++) {
-        if (strstr(output.c_str(), entry.helps[i]) == nullptr)
-            return false;
-    }
-
-    return true;
-}
-
-
 // Get the MAC type (and creator) for a specific file.
-const SignToMac *GetMacType(const std::string &path)
+// |data| is the beginning of the file (or the whole file), it's matched
+// against magic numbers before trying extensions.
+const SignToMac *GetMacType(const std::string &path, const uint8_t *data,
+    uint32_t size)
 {
-    auto filetxt = CallFileCommand(path);
+    static const MagicTrie trie;
 
-    for (auto const &entry : signs_to_mac) {
-        switch (entry.type) {
-            MAC_MATCH(Extension, UnixMatchExtension, entry, path);
-            MAC_MATCH(FileCmd, UnixMatchFileCmd, entry, filetxt);
-        }
+    // Only the extensions of the entries before the magic match can win.
+    int found = (data != nullptr) ? trie.Match(data, size) : -1;
+    int last = (found != -1) ? found : std::end(signs_to_mac) - signs_to_mac;
+
+    for (int i = 0; i < last; i++) {
+        auto const &entry = signs_to_mac[i];
+        if (entry.type == SignToMac::Extension && UnixMatchExtension(entry, path))
+            return &entry;
     }
 
-    return nullptr;
+    return (found != -1) ? &signs_to_mac[found] : nullptr;
 }
 
 
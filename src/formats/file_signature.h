@@ -22,27 +22,45 @@ this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <path.hpp>
 #include <string>
+#include <inttypes.h>
 
 namespace maconv {
 namespace utils {
 
 
+// Bytes to find at a given offset of a file (for magic numbers).
+struct MagicBytes {
+    uint32_t offset; // Offset of the bytes in the file.
+    const char *bytes; // Bytes to find (may contain \0).
+    uint32_t len; // Number of bytes.
+};
+
+
 // An entry in the "Unix-to-Mac" array.
 struct SignToMac {
 
-    // Maching type: extension or file command.
-    enum Type { Extension, FileCmd } type;
+    // Maching type: extension or magic number (file content).
+    enum Type { Extension, Magic } type;
 
-    // Help strings (and count)
+    // Help strings (and count) (Extension only).
     int help_len;
-    const char **helps;
+    const char *const *helps;
+
+    // Magic bytes (and count) (Magic only).
+    int magic_len;
+    const MagicBytes *magic;
 
     // MAC creator and type.
     const char *creator;
     const char *mac;
 
-    constexpr SignToMac(Type t, const char *c, const char *m, const char **hs, int hl)
-        : type{t}, creator{c}, mac{m}, help_len{hl}, helps{hs} {}
+    constexpr SignToMac(const char *c, const char *m, const char *const *hs, int hl)
+        : type{Extension}, help_len{hl}, helps{hs}, magic_len{0}, magic{nullptr},
+          creator{c}, mac{m} {}
+
+    constexpr SignToMac(const char *c, const char *m, const MagicBytes *mb, int ml)
+        : type{Magic}, help_len{0}, helps{nullptr}, magic_len{ml}, magic{mb},
+          creator{c}, mac{m} {}
 };
 
 
@@ -62,7 +80,10 @@ extern SignToUnix signs_to_unix[];
 
 
 // Get the MAC type (and creator) for a specific file.
-const SignToMac *GetMacType(const std::string &path);
+// |data| is the beginning of the file (or the whole file), it's matched
+// against magic numbers before trying extensions.
+const SignToMac *GetMacType(const std::string &path, const uint8_t *data,
+    uint32_t size);
 
 
 } // namespace utils
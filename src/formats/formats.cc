@@ -36,12 +36,15 @@ namespace maconv {
 // Prefered conversion format.
 ConvData prefered_conv = { ConvData::NotFound };
 
+// Number of threads used for extracting archives.
+int num_jobs = 1;
+
 
 // All available converters.
 ConvDataSingle formats_single[kNumFormatsSingle] = {
-    { "macbin", ".bin", IsFileMacBinary, ReadMacBinary, WriteMacBinary },
-    { "binhex", ".hqx", IsFileBinHex, ReadBinHex, WriteBinHex },
-    { "applesingle", ".as", IsFileAppleSingle, ReadAppleSingle, WriteAppleSingle },
+    { "macbin", ".bin", FileFormat::MacBinary, IsFileMacBinary, ReadMacBinary, WriteMacBinary },
+    { "binhex", ".hqx", FileFormat::BinHex, IsFileBinHex, ReadBinHex, WriteBinHex },
+    { "applesingle", ".as", FileFormat::AppleSingle, IsFileAppleSingle, ReadAppleSingle, WriteAppleSingle },
 };
 
 
@@ -102,19 +105,73 @@ std::string GetFilenameFor(const std::string &original, ConvData conv)
 
 
 
+// Is a file a disk image? DiskCopy images are unpacked first.
+static bool IsDiskImage(fs::FileReader &reader, FormatSet formats, UnPacked &u)
+{
+    if (formats.Has(FileFormat::DiskCopy) && IsFileDiskCopy(reader)) {
+        UnPackDiskCopy(reader, u.file);
+        return true;
+    }
+
+    if (formats.Has(FileFormat::HfsDisk) && IsFileHfsDisk(reader))
+        return true;
+    return IsFileDisk(u.file.filename);
+}
+
+
+// Kind of container found in a file.
+enum class Container { None, Stuffit1, Stuffit5, Disk };
+
+
+// Find the container a file is in. Stuffit archives are tested first as
+// their headers are checked more strictly than a disk name extension.
+static Container FindContainer(fs::FileReader &reader, UnPacked &u)
+{
+    auto formats = DetectFormats(reader);
+
+    if (formats.Has(FileFormat::Stuffit1) && IsFileStuffit1(reader))
+        return Container::Stuffit1;
+    if (formats.Has(FileFormat::Stuffit5) && IsFileStuffit5(reader))
+        return Container::Stuffit5;
+    if (IsDiskImage(reader, formats, u))
+        return Container::Disk;
+    return Container::None;
+}
+
+
 // Extract an archive or a disk.
 bool ExtractArchiveOrDisk(UnPacked &u, const std::string &output)
 {
     fs::FileReader reader {u.file};
+    auto container = FindContainer(reader, u);
+
+    // Disk images are mounted from memory (their forks are mostly contiguous
+    // so readahead helps), archives are read linearly.
+    bool is_disk = (container == Container::Disk);
+    u.d1.Advise(is_disk ? fs::Access::Normal : fs::Access::Sequential);
+
+    switch (container) {
+        case Container::Stuffit1: ExtractStuffit1(reader, output); break;
+        case Container::Stuffit5: ExtractStuffit5(reader, output); break;
+        case Container::Disk: ExtractDisk(u, output); break;
+        default: return false;
+    }
+
+    return true;
+}
 
-    if (IsFileDisk(u.file.filename))
-        ExtractDisk(u, output);
-    else if (IsFileStuffit1(reader))
-        ExtractStuffit1(reader, output);
-    else if (IsFileStuffit5(reader))
-        ExtractStuffit5(reader, output);
-    else
-        return false;
+
+// List the content of an archive or a disk.
+bool ListArchiveOrDisk(UnPacked &u)
+{
+    fs::FileReader reader {u.file};
+
+    switch (FindContainer(reader, u)) {
+        case Container::Stuffit1: ListStuffit1(reader); break;
+        case Container::Stuffit5: ListStuffit5(reader); break;
+        case Container::Disk: ListDisk(u); break;
+        default: return false;
+    }
 
     return true;
 }
@@ -23,6 +23,7 @@ this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "fs/file.h"
 #include "fs/file_reader.h"
 #include "fs/file_writer.h"
+#include "formats/magic.h"
 
 #include <fstream>
 
@@ -31,7 +32,7 @@ namespace maconv {
 
 // Data for unpacked files.
 struct UnPacked {
-    fs::DataPtr d1, d2; // Data from opened files.
+    fs::MappedFile d1, d2; // Data from opened files.
     fs::File file; // The unpacked file.
     std::string n1, n2; // Input file names.
 };
@@ -45,6 +46,7 @@ struct ConvDataSingle {
 
     const char *name; // Converter name.
     const char *ext; // File extension.
+    FileFormat format; // Format detected by its magic number.
     TestF test;
     ReaderF read;
     WriterF write;
@@ -73,6 +75,9 @@ struct ConvData {
 // Prefered conversion format.
 extern ConvData prefered_conv;
 
+// Number of threads used for extracting archives.
+extern int num_jobs;
+
 // Single converters (converters that need only one file).
 constexpr int kNumFormatsSingle = 3;
 extern ConvDataSingle formats_single[kNumFormatsSingle];
@@ -103,6 +108,9 @@ UnPacked UnPackLocalFile(const std::string &input, bool recurs = true);
 // Extract an archive or a disk.
 bool ExtractArchiveOrDisk(UnPacked &u, const std::string &output);
 
+// List the content of an archive or a disk.
+bool ListArchiveOrDisk(UnPacked &u);
+
 
 // Pack a local file.
 void PackLocalFile(fs::File &file, const std::string &filename, ConvData data);
@@ -0,0 +1,195 @@
+/*
+
+List the content of an archive or a disk (without extracting it).
+
+Copyright (C) 2019, Guillaume Gonnet
+
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "formats/listing.h"
+
+#include <cstdio>
+
+namespace maconv {
+
+
+// Output format for listing entries.
+ListFormat list_format = ListFormat::Text;
+
+
+
+// Convert a 4 chars code (type or creator) to a string.
+static std::string FourCharCode(uint32_t code)
+{
+    std::string str(4, ' ');
+    for (int i = 0; i < 4; i++)
+        str[i] = static_cast<char>(code >> (24 - 8 * i));
+    return str;
+}
+
+
+// Format a date (local time, as it is stored by Macintosh).
+static std::string FormatDate(time_t date, const char *fmt)
+{
+    char buffer[32];
+    struct tm tm;
+
+    if (localtime_r(&date, &tm) == nullptr || strftime(buffer, sizeof(buffer), fmt, &tm) == 0)
+        return "";
+    return buffer;
+}
+
+
+
+// Unicode code points of the MacRoman characters from 0x80 to 0xFF.
+static const uint16_t kMacRomanToUnicode[128] = {
+    0x00C4, 0x00C5, 0x00C7, 0x00C9, 0x00D1, 0x00D6, 0x00DC, 0x00E1,
+    0x00E0, 0x00E2, 0x00E4, 0x00E3, 0x00E5, 0x00E7, 0x00E9, 0x00E8,
+    0x00EA, 0x00EB, 0x00ED, 0x00EC, 0x00EE, 0x00EF, 0x00F1, 0x00F3,
+    0x00F2, 0x00F4, 0x00F6, 0x00F5, 0x00FA, 0x00F9, 0x00FB, 0x00FC,
+    0x2020, 0x00B0, 0x00A2, 0x00A3, 0x00A7, 0x2022, 0x00B6, 0x00DF,
+    0x00AE, 0x00A9, 0x2122, 0x00B4, 0x00A8, 0x2260, 0x00C6, 0x00D8,
+    0x221E, 0x00B1, 0x2264, 0x2265, 0x00A5, 0x00B5, 0x2202, 0x2211,
+    0x220F, 0x03C0, 0x222B, 0x00AA, 0x00BA, 0x03A9, 0x00E6, 0x00F8,
+    0x00BF, 0x00A1, 0x00AC, 0x221A, 0x0192, 0x2248, 0x2206, 0x00AB,
+    0x00BB, 0x2026, 0x00A0, 0x00C0, 0x00C3, 0x00D5, 0x0152, 0x0153,
+    0x2013, 0x2014, 0x201C, 0x201D, 0x2018, 0x2019, 0x00F7, 0x25CA,
+    0x00FF, 0x0178, 0x2044, 0x20AC, 0x2039, 0x203A, 0xFB01, 0xFB02,
+    0x2021, 0x00B7, 0x201A, 0x201E, 0x2030, 0x00C2, 0x00CA, 0x00C1,
+    0x00CB, 0x00C8, 0x00CD, 0x00CE, 0x00CF, 0x00CC, 0x00D3, 0x00D4,
+    0xF8FF, 0x00D2, 0x00DA, 0x00DB, 0x00D9, 0x0131, 0x02C6, 0x02DC,
+    0x00AF, 0x02D8, 0x02D9, 0x02DA, 0x00B8, 0x02DD, 0x02DB, 0x02C7,
+};
+
+
+// Print a string as a JSON string.
+// Macintosh names are in MacRoman: characters above 0x7F are converted to
+// Unicode and escaped, so the output stays ASCII.
+static void PrintJsonString(const std::string &str)
+{
+    putchar('"');
+
+    for (unsigned char c : str) {
+        if (c == '"' || c == '\\')
+            printf("\\%c", c);
+        else if (c >= 0x80)
+            printf("\\u%04x", kMacRomanToUnicode[c - 0x80]);
+        else if (c < 0x20 || c == 0x7F)
+            printf("\\u%04x", c);
+        else
+            putchar(c);
+    }
+
+    putchar('"');
+}
+
+
+// Print a fork as a JSON object.
+static void PrintJsonFork(const ListFork &fork)
+{
+    printf("{\"size\":%u,\"comp_size\":%u,\"method\":", fork.size, fork.comp_size);
+    if (!fork.method.empty())
+        PrintJsonString(fork.method);
+    else
+        printf("null");
+    putchar('}');
+}
+
+
+// Print an entry as a single line of JSON.
+static void PrintJsonEntry(const ListEntry &ent)
+{
+    printf("{\"path\":");
+    PrintJsonString(ent.path);
+    printf(",\"kind\":\"%s\"", ent.is_dir ? "folder" : "file");
+
+    // Dates (formatted as ISO 8601).
+    printf(",\"created\":");
+    PrintJsonString(FormatDate(ent.creation_date, "%Y-%m-%dT%H:%M:%S"));
+    printf(",\"modified\":");
+    PrintJsonString(FormatDate(ent.modif_date, "%Y-%m-%dT%H:%M:%S"));
+
+    // Folders don't have forks.
+    if (!ent.is_dir) {
+        printf(",\"type\":");
+        PrintJsonString(FourCharCode(ent.type));
+        printf(",\"creator\":");
+        PrintJsonString(FourCharCode(ent.creator));
+        printf(",\"flags\":%u,\"data\":", ent.flags);
+        PrintJsonFork(ent.data);
+        printf(",\"res\":");
+        PrintJsonFork(ent.res);
+    }
+
+    printf("}\n");
+}
+
+
+
+// Make a 4 chars code printable (for text listing).
+static std::string PrintableCode(uint32_t code)
+{
+    std::string str = FourCharCode(code);
+    for (auto &c : str) {
+        if (static_cast<unsigned char>(c) < 0x20 || static_cast<unsigned char>(c) >= 0x7F)
+            c = '.';
+    }
+    return str;
+}
+
+
+// Print an entry as a line of text.
+static void PrintTextEntry(const ListEntry &ent)
+{
+    std::string date = FormatDate(ent.modif_date, "%Y-%m-%d %H:%M");
+
+    if (ent.is_dir) {
+        printf("---- ---- %10s %10s %10s %10s  %-15s  %-16s  %s/\n", "", "", "", "",
+            "folder", date.c_str(), ent.path.c_str());
+        return;
+    }
+
+    std::string method = (ent.data.method.empty() ? "-" : ent.data.method) + "/"
+        + (ent.res.method.empty() ? "-" : ent.res.method);
+
+    printf("%s %s %10u %10u %10u %10u  %-15s  %-16s  %s\n",
+        PrintableCode(ent.type).c_str(), PrintableCode(ent.creator).c_str(),
+        ent.data.size, ent.data.comp_size, ent.res.size, ent.res.comp_size,
+        method.c_str(), date.c_str(), ent.path.c_str());
+}
+
+
+
+// Print the header of the listing (before the first entry).
+void PrintListHeader()
+{
+    if (list_format == ListFormat::Text) {
+        printf("Type Crtr %10s %10s %10s %10s  %-15s  %-16s  %s\n", "Data", "Packed",
+            "Rsrc", "Packed", "Method", "Modified", "Name");
+    }
+}
+
+
+// Print a single entry of an archive or a disk.
+void PrintListEntry(const ListEntry &ent)
+{
+    if (list_format == ListFormat::Json)
+        PrintJsonEntry(ent);
+    else
+        PrintTextEntry(ent);
+}
+
+
+} // namespace maconv
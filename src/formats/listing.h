@@ -0,0 +1,73 @@
+/*
+
+List the content of an archive or a disk (without extracting it).
+
+Copyright (C) 2019, Guillaume Gonnet
+
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include <string>
+#include <inttypes.h>
+#include <time.h>
+
+namespace maconv {
+
+
+// Output format of the listing.
+enum class ListFormat {
+    Text, Json
+};
+
+
+// Information about a fork of a listed entry.
+struct ListFork {
+    uint32_t size; // Fork size (uncompressed).
+    uint32_t comp_size; // Fork size (compressed).
+    std::string method; // Compression method (empty if not compressed).
+};
+
+
+// An entry of an archive or a disk (file or folder).
+struct ListEntry {
+    std::string path; // Path of the entry (relative to the root).
+    bool is_dir; // Is the entry a folder?
+
+    uint32_t type; // File type (4 chars).
+    uint32_t creator; // File creator (4 chars).
+    uint16_t flags; // Finder flags.
+
+    time_t creation_date; // Creation date of the file (Unix time).
+    time_t modif_date; // Modification date of the file (Unix time).
+
+    ListFork data; // Data fork.
+    ListFork res; // Ressource fork.
+};
+
+
+
+// Output format for listing entries.
+extern ListFormat list_format;
+
+
+// Print the header of the listing (before the first entry).
+void PrintListHeader();
+
+// Print a single entry of an archive or a disk.
+void PrintListEntry(const ListEntry &ent);
+
+
+} // namespace maconv
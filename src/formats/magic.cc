@@ -0,0 +1,100 @@
+/*
+
+Detect the format of a file from its magic number.
+
+Copyright (C) 2019, Guillaume Gonnet
+
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "formats/magic.h"
+
+#include <array>
+#include <cstring>
+#include <vector>
+
+namespace maconv {
+
+
+// Magic number of a format: bytes to find at an offset.
+struct FormatMagic {
+    FileFormat format; // Detected format.
+    uint32_t offset; // Offset of the magic number.
+    const char *bytes; // Magic number.
+    uint32_t len; // Length of the magic number.
+};
+
+
+// Create a new magic number entry.
+#define M(format, offset, bytes) \
+    FormatMagic { FileFormat::format, offset, bytes, sizeof(bytes) - 1 }
+
+
+// All magic numbers (most of them are in the first 128 bytes).
+static const FormatMagic kFormatMagics[] = {
+    M(AppleSingle, 0, "\x00\x05\x16\x00"),
+    M(AppleDouble, 0, "\x00\x05\x16\x07"),
+    M(MacBinary,   0, "\x00"),
+    M(BinHex,      0, "(This file must be converted with BinHex"),
+
+    M(Stuffit1,    0, "S"),
+    M(Stuffit5,    0, "StuffIt (c)1997-"),
+
+    M(DiskCopy,    0x52, "\x01\x00"),
+    M(HfsDisk,     1024, "BD"),
+};
+
+
+
+// Magic numbers sorted by the first byte of the file: magic numbers at
+// offset 0 are in the list of their first byte, others are in all lists.
+struct MagicTable {
+
+    MagicTable()
+    {
+        for (auto &magic : kFormatMagics) {
+            if (magic.offset != 0)
+                for (auto &list : lists) list.push_back(&magic);
+            else
+                lists[static_cast<uint8_t>(magic.bytes[0])].push_back(&magic);
+        }
+    }
+
+    std::array<std::vector<const FormatMagic *>, 256> lists;
+};
+
+
+
+// Find the formats a file may be in (by looking at its first bytes once).
+// A format in the set still needs to be validated by its test function.
+FormatSet DetectFormats(const fs::FileReader &reader)
+{
+    static const MagicTable table;
+    FormatSet formats;
+
+    if (reader.file_size == 0)
+        return formats;
+
+    for (auto magic : table.lists[reader.data[0]]) {
+        if (magic->offset + magic->len > reader.file_size)
+            continue;
+        if (memcmp(reader.data + magic->offset, magic->bytes, magic->len) == 0)
+            formats.Add(magic->format);
+    }
+
+    return formats;
+}
+
+
+} // namespace maconv
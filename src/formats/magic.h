@@ -0,0 +1,54 @@
+/*
+
+Detect the format of a file from its magic number.
+
+Copyright (C) 2019, Guillaume Gonnet
+
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include "fs/file_reader.h"
+
+namespace maconv {
+
+
+// Formats that can be detected from their magic number.
+enum class FileFormat : uint8_t {
+    MacBinary, BinHex, AppleSingle, AppleDouble,
+    Stuffit1, Stuffit5, HfsDisk, DiskCopy
+};
+
+
+// Set of formats that a file may be in.
+struct FormatSet {
+
+    // Does the set contain |format|?
+    bool Has(FileFormat format) const { return bits & (1u << (int)format); }
+
+    // Add |format| to the set.
+    void Add(FileFormat format) { bits |= 1u << (int)format; }
+
+    uint32_t bits = 0; // A bit for each format.
+};
+
+
+
+// Find the formats a file may be in (by looking at its first bytes once).
+// A format in the set still needs to be validated by its test function.
+FormatSet DetectFormats(const fs::FileReader &reader);
+
+
+} // namespace maconv
@@ -41,7 +41,13 @@ static void UnPackDouble(fs::FileReader &reader, UnPacked &u)
 // Unpack a single file.
 bool UnPackSingle(fs::File &file, fs::FileReader &reader)
 {
+    // Only the formats whose magic number matches are tested.
+    auto formats = DetectFormats(reader);
+
     for (auto &format : formats_single) {
+        if (!formats.Has(format.format))
+            continue;
+
         // Test if the file is in this format (if true, unpack it).
         reader.Seek(0);
         if (!format.test(reader))
@@ -50,6 +56,9 @@ bool UnPackSingle(fs::File &file, fs::FileReader &reader)
         reader.Seek(0);
         file.Reset();
         format.read(reader, file);
+
+        if (reader.HasFailed())
+            StopOnError("%s is truncated (%s format)", reader.filename.c_str(), format.name);
         return true;
     }
 
@@ -65,12 +74,12 @@ static UnPacked UnPackFirstLocalFile(const std::string &input)
     u.n1 = input;
 
     // Read the input file given.
-    int size = ReadLocalFile(input, u.d1);
-    if (size == -1)
+    if (!ReadLocalFile(input, u.d1))
         StopOnError("can't read input file %s", input.c_str());
 
     // Unpack one or two files.
-    fs::FileReader reader {u.d1.get(), static_cast<uint32_t>(size), input};
+    u.d1.Advise(fs::Access::Sequential);
+    fs::FileReader reader {u.d1.data, u.d1.size, input};
     if (!UnPackSingle(u.file, reader))
         UnPackDouble(reader, u); // Cannot fail ("rsrc" accepts all files).
 
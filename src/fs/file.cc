@@ -19,9 +19,10 @@ this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #include "fs/file.h"
+#include "formats/file_signature.h"
+
+#include <libhfs/data.h>
 
-#include <fstream>
-#include <make_unique.hpp>
 #include <sys/types.h>
 #include <utime.h>
 
@@ -36,36 +37,24 @@ void fs::File::Reset()
     res = nullptr;
     data_size = 0;
     res_size = 0;
+    data_stream = nullptr;
+    res_stream = nullptr;
 
     creation_date = 0;
     modif_date = 0;
 
-    creator = 0x63636363; // ????
-    type = 0x63636363; // ????
+    creator = kUnknownType;
+    type = kUnknownType;
 
     filename.clear();
-    is_raw = false;
 }
 
 
 
-// Read data from a local file.
-int ReadLocalFile(const std::string &filename, fs::DataPtr &ptr)
+// Read data from a local file (the file is mapped, not copied).
+bool ReadLocalFile(const std::string &filename, fs::MappedFile &file)
 {
-    std::ifstream file {filename, std::ios::binary};
-    if (!file)
-        return -1;
-
-    // Get file size and allocate this size.
-    file.seekg(0, std::ios_base::end);
-    int size = file.tellg();
-    ptr = std::make_unique<uint8_t[]>(size);
-
-    // Read the file entirely.
-    file.seekg(0, std::ios_base::beg);
-    file.read(reinterpret_cast<char *>(ptr.get()), size);
-
-    return size;
+    return file.Open(filename);
 }
 
 
@@ -73,7 +62,20 @@ int ReadLocalFile(const std::string &filename, fs::DataPtr &ptr)
 // Get file infotmation from a local file.
 void GetLocalInfo(const std::string &filename, fs::File &file, bool is_res)
 {
-    // TODO.
+    // Keep the type and creator if they are already known (e.g. read from
+    // the Finder information of an AppleSingle file).
+    if (file.type != fs::kUnknownType && file.creator != fs::kUnknownType)
+        return;
+
+    // Guess type and creator from the content of the file (or its name).
+    auto sign = utils::GetMacType(filename, file.data, file.data_size);
+    if (sign == nullptr)
+        return;
+
+    if (file.type == fs::kUnknownType)
+        file.type = d_getsl(reinterpret_cast<const unsigned char *>(sign->mac));
+    if (file.creator == fs::kUnknownType)
+        file.creator = d_getsl(reinterpret_cast<const unsigned char *>(sign->creator));
 }
 
 
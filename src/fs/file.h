@@ -20,7 +20,11 @@ this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #pragma once
 
+#include "fs/mapped_file.h"
+
+#include <functional>
 #include <memory>
+#include <string>
 #include <vector>
 #include <time.h>
 
@@ -31,6 +35,14 @@ namespace fs {
 // An unique pointer on memory data.
 using DataPtr = std::unique_ptr<uint8_t[]>;
 
+// A function writing a fork chunk by chunk (for forks not stored in memory).
+struct FileWriter;
+using ForkStream = std::function<void (FileWriter &writer)>;
+
+
+// Type or creator of a file when it is unknown.
+constexpr uint32_t kUnknownType = 0x63636363; // ????
+
 
 // Store data about a Macintosh file.
 struct File {
@@ -45,6 +57,9 @@ struct File {
     uint8_t *res; // Ressource fork.
     uint32_t res_size; // Size of the ressource fork.
 
+    ForkStream data_stream; // Data fork stream (used instead of |data|).
+    ForkStream res_stream; // Ressource fork stream (used instead of |res|).
+
 
     std::string filename; // Name of the file.
     uint32_t type; // File type (4 chars).
@@ -55,7 +70,6 @@ struct File {
     time_t modif_date; // Modification date of the file (Unix file).
 
 
-    bool is_raw; // Is this file from "raw" format.
     std::vector<DataPtr> mem_pool; // Memory pool for storing data.
 };
 
@@ -64,8 +78,8 @@ struct File {
 
 
 
-// Read data from a local file.
-int ReadLocalFile(const std::string &filename, fs::DataPtr &ptr);
+// Read data from a local file (mapped, not copied; return false on error).
+bool ReadLocalFile(const std::string &filename, fs::MappedFile &file);
 
 
 // Get file infotmation from a local file.
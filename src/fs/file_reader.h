@@ -21,9 +21,8 @@ this program.  If not, see <https://www.gnu.org/licenses/>.
 #pragma once
 
 #include "fs/file.h"
-#include "utils/buffer_stream.h"
 
-#include <sstream>
+#include <cstring>
 #include <string>
 #include <time.h>
 
@@ -32,33 +31,44 @@ namespace fs {
 
 
 // Helper class for reading data from a file.
+// This is a simple cursor on raw data: reading past the end of the data
+// doesn't read anything, returns 0 and marks the reader as failed.
 struct FileReader {
 
-    FileReader(uint8_t *data, uint32_t size, std::string filename = "");
-    FileReader(File &file);
+    FileReader(uint8_t *d, uint32_t size, std::string fn = "")
+        : data{d}, file_size{size}, filename{std::move(fn)} {}
 
+    FileReader(File &file)
+        : data{file.data}, file_size{file.data_size}, filename{file.filename} {}
 
-    // Set the position in the stream.
-    void Seek(uint32_t pos) { stream.seekg(pos); }
-    void Seek(uint32_t off, std::ios_base::seekdir dir) { stream.seekg(off, dir); }
+
+    // Set the position in the data.
+    void Seek(uint32_t p) { pos = (p <= file_size) ? p : Fail(); }
 
     // Get the absolute position.
-    uint32_t Tell() { return stream.tellg(); }
+    uint32_t Tell() const { return pos; }
 
     // Skip from reading a number of bytes.
-    void Skip(uint32_t length) { stream.ignore(length); }
+    void Skip(uint32_t length) { pos = Has(length) ? pos + length : Fail(); }
+
+
+    // Are there at least |length| bytes left?
+    bool Has(uint32_t length) const { return length <= file_size - pos; }
+
+    // Has a read or a seek gone past the end of the data?
+    bool HasFailed() const { return failed; }
 
 
     // Read a single byte.
-    uint8_t ReadByte();
+    uint8_t ReadByte() { return Has(1) ? data[pos++] : Fail(); }
 
     // Read a single short (16bits) (BE = big endian, LE = little endian).
-    uint16_t ReadHalfBE();
-    uint16_t ReadHalfLE();
+    uint16_t ReadHalfBE() { return __builtin_bswap16(Load<uint16_t>()); }
+    uint16_t ReadHalfLE() { return Load<uint16_t>(); }
 
     // Read a single word (32bits) (BE = big endian, LE = little endian).
-    uint32_t ReadWordBE();
-    uint32_t ReadWordLE();
+    uint32_t ReadWordBE() { return __builtin_bswap32(Load<uint32_t>()); }
+    uint32_t ReadWordLE() { return Load<uint32_t>(); }
 
     // Read a Macintosh date or a J2000 date (epoch on January 1, 2000).
     time_t ReadMacDate();
@@ -71,14 +81,59 @@ struct FileReader {
 
     uint8_t *data; // Input data.
     uint32_t file_size; // Total size of the file.
-
-    utils::RawDataStreamBuf stream_buf; // Stream buffer from raw data buffer.
-    std::istream stream; // Stream for reading data.
     std::string filename; // Name of the file to read.
+
+    uint32_t pos = 0; // Current position in the data.
+    bool failed = false; // Has a read gone past the end?
+
+private:
+
+    // Mark the reader as failed and move it at the end of the data.
+    uint32_t Fail() { failed = true; pos = file_size; return 0; }
+
+    // Load an integer (in host order).
+    template <typename T>
+    T Load()
+    {
+        if (!Has(sizeof(T)))
+            return Fail();
+
+        T value;
+        memcpy(&value, data + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
 };
 
 
 
+// Read a string (read until \0).
+inline std::string FileReader::ReadString()
+{
+    uint32_t left = file_size - pos;
+    auto start = reinterpret_cast<const char *>(data + pos);
+    auto end = static_cast<const char *>(memchr(start, '\0', left));
+    if (end == nullptr)
+        return (Fail(), std::string {start, left});
+
+    pos += (end - start) + 1;
+    return std::string {start, end};
+}
+
+
+// Read a string of |size|.
+inline std::string FileReader::ReadString(uint32_t size)
+{
+    if (!Has(size))
+        return (Fail(), std::string {});
+
+    auto start = reinterpret_cast<const char *>(data + pos);
+    pos += size;
+    return std::string {start, size};
+}
+
+
+
 // Test a condtion and return false if the condition is false.
 #define IS_COND(cond) if (!(cond)) return false
 
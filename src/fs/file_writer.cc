@@ -22,6 +22,9 @@ this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <libhfs/data.h>
 
+#include <algorithm>
+#include <cstring>
+
 namespace maconv {
 namespace fs {
 
@@ -45,8 +48,27 @@ void FileWriter::Write(uint8_t *bytes, uint32_t length)
 // Fill |length| bytes of |byte|.
 void FileWriter::Fill(uint8_t byte, uint32_t length)
 {
-    for (uint32_t i = 0; i < length; i++)
-        stream.put(byte);
+    char chunk[512];
+    memset(chunk, byte, std::min<uint32_t>(length, sizeof(chunk)));
+
+    for (uint32_t len; length > 0; length -= len) {
+        len = std::min<uint32_t>(length, sizeof(chunk));
+        stream.write(chunk, len);
+    }
+}
+
+
+// Write a fork of a file (from memory or from its fork stream).
+void FileWriter::WriteFork(File &file, bool is_res)
+{
+    auto &fork_stream = is_res ? file.res_stream : file.data_stream;
+
+    if (fork_stream)
+        fork_stream(*this);
+    else if (is_res)
+        Write(file.res, file.res_size);
+    else
+        Write(file.data, file.data_size);
 }
 
 
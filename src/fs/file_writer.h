@@ -20,6 +20,8 @@ this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #pragma once
 
+#include "fs/file.h"
+
 #include <ostream>
 #include <string>
 
@@ -39,6 +41,9 @@ struct FileWriter {
     // Fill |length| bytes of |byte|.
     void Fill(uint8_t byte, uint32_t length);
 
+    // Write a fork of a file (from memory or from its fork stream).
+    void WriteFork(File &file, bool is_res);
+
 
     // Write a single byte.
     void WriteByte(uint8_t byte);
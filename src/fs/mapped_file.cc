@@ -0,0 +1,144 @@
+/*
+
+Mapped file: map a local file in memory (without copying it).
+
+Copyright (C) 2019, Guillaume Gonnet
+
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "fs/mapped_file.h"
+
+#include <make_unique.hpp>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace maconv {
+namespace fs {
+
+
+
+// Move constructor.
+MappedFile::MappedFile(MappedFile &&other)
+{
+    *this = std::move(other);
+}
+
+
+// Move assignment.
+MappedFile &MappedFile::operator=(MappedFile &&other)
+{
+    if (this == &other)
+        return *this;
+
+    Close();
+    data = other.data;
+    size = other.size;
+    is_mapped = other.is_mapped;
+    buffer = std::move(other.buffer);
+
+    other.data = nullptr;
+    other.size = 0;
+    other.is_mapped = false;
+    return *this;
+}
+
+
+
+// Read a file entirely in the fallback buffer.
+static bool ReadWholeFile(int fd, MappedFile &file)
+{
+    file.buffer = std::make_unique<uint8_t[]>(file.size);
+    file.data = file.buffer.get();
+
+    for (uint32_t pos = 0; pos < file.size;) {
+        ssize_t len = read(fd, file.data + pos, file.size - pos);
+        if (len <= 0)
+            return false;
+        pos += len;
+    }
+
+    return true;
+}
+
+
+// Map a local file (return false on error).
+bool MappedFile::Open(const std::string &filename)
+{
+    Close();
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size > UINT32_MAX)
+        return (close(fd), false);
+    size = st.st_size;
+
+    // Nothing to map for an empty file.
+    if (size == 0)
+        return (close(fd), true);
+
+    // Map the file; if the file can't be mapped, read it instead.
+    void *addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    bool ok = true;
+
+    if (addr != MAP_FAILED) {
+        data = static_cast<uint8_t *>(addr);
+        is_mapped = true;
+    } else {
+        ok = ReadWholeFile(fd, *this);
+    }
+
+    close(fd);
+    return ok;
+}
+
+
+// Unmap the file (if mapped).
+void MappedFile::Close()
+{
+    if (is_mapped)
+        munmap(data, size);
+
+    buffer.reset();
+    data = nullptr;
+    size = 0;
+    is_mapped = false;
+}
+
+
+
+// Tell the kernel how the data will be accessed.
+void MappedFile::Advise(Access access)
+{
+    if (!is_mapped)
+        return;
+
+    int advice = MADV_NORMAL;
+    if (access == Access::Sequential)
+        advice = MADV_SEQUENTIAL;
+    else if (access == Access::Random)
+        advice = MADV_RANDOM;
+
+    madvise(data, size, advice);
+}
+
+
+
+} // namespace fs
+} // namespace maconv
@@ -0,0 +1,69 @@
+/*
+
+Mapped file: map a local file in memory (without copying it).
+
+Copyright (C) 2019, Guillaume Gonnet
+
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <inttypes.h>
+
+namespace maconv {
+namespace fs {
+
+
+// How the data of a mapped file will be accessed.
+enum class Access {
+    Normal, Sequential, Random
+};
+
+
+// A local file mapped in memory (read only).
+struct MappedFile {
+
+    MappedFile() = default;
+    ~MappedFile() { Close(); }
+
+    MappedFile(MappedFile &&other);
+    MappedFile &operator=(MappedFile &&other);
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+
+    // Map a local file (return false on error).
+    bool Open(const std::string &filename);
+
+    // Unmap the file (if mapped).
+    void Close();
+
+    // Tell the kernel how the data will be accessed.
+    void Advise(Access access);
+
+
+    uint8_t *data = nullptr; // Mapped data.
+    uint32_t size = 0; // Size of the data.
+
+    bool is_mapped = false; // Is |data| a memory mapping?
+    std::unique_ptr<uint8_t[]> buffer; // Fallback buffer (if mmap failed).
+};
+
+
+} // namespace fs
+} // namespace maconv
@@ -19,6 +19,7 @@ this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #include "commands.h"
+#include "disk/disk.h"
 
 #include <CLI11.hpp>
 #include <cstdarg>
@@ -39,9 +40,11 @@ extern "C" void LogDebug(const char *fmt, ...)
     va_list args;
     va_start(args, fmt);
 
+    flockfile(stdout);
     vprintf(fmt, args);
-    va_end(args);
     printf("\n");
+    funlockfile(stdout);
+    va_end(args);
 }
 
 
@@ -61,6 +64,17 @@ extern "C" void StopOnError(const char *fmt, ...)
 
 
 
+// Add the HFS block cache option to a sub-command reading or writing disks.
+static void AddCacheOption(CLI::App *app)
+{
+    app->add_option("--hfs-cache", disk::cache_size, "Size of the HFS block cache in KB (2048 by default, 1048576 at most, 0 to disable)")
+        ->envname("MACONV_HFS_CACHE")
+        ->check(CLI::Range(0L, 1L << 20))
+        ->type_name("<KB>");
+}
+
+
+
 // Entry point of the application.
 int main(int argc, char **argv)
 {
@@ -106,6 +120,36 @@ int main(int argc, char **argv)
         ->default_val("rsrc")
         ->type_name("<format>");
 
+    int e_jobs = 1;
+    e_app->add_option("-j,--jobs", e_jobs, "Number of extraction threads (1 by default)")
+        ->type_name("<N>");
+
+    FilterOptions e_filter;
+    e_app->add_option("--include", e_filter.include, "Extract only files matching a glob")
+        ->type_name("<glob>");
+    e_app->add_option("--exclude", e_filter.exclude, "Don't extract files matching a glob")
+        ->type_name("<glob>");
+    e_app->add_option("--type", e_filter.types, "Extract only files with a type (e.g. TEXT)")
+        ->type_name("<type>");
+    e_app->add_option("--creator", e_filter.creators, "Extract only files with a creator")
+        ->type_name("<creator>");
+
+    AddCacheOption(e_app);
+
+
+    // List "l" sub-command.
+    auto l_app = app.add_subcommand("l", "List the content of a Stuffit archive or a disk file");
+
+    std::string l_input;
+    l_app->add_option("input", l_input, "Input file to list")
+        ->required()
+        ->type_name("<filename>");
+
+    bool l_json = false;
+    l_app->add_flag("--json", l_json, "Print one JSON object per entry");
+
+    AddCacheOption(l_app);
+
 
     // Disk creation "d" sub-command.
     auto d_app = app.add_subcommand("d", "Create an HFS disk file");
@@ -123,6 +167,8 @@ int main(int argc, char **argv)
     d_app->add_option("-n,--name", d_name, "Volume name (Input folder name by default)")
         ->type_name("<name>");
 
+    AddCacheOption(d_app);
+
 
     // Parse the CLI.
     CLI11_PARSE(app, argc, argv);
@@ -131,7 +177,9 @@ int main(int argc, char **argv)
     if (*c_app)
         RunConvertCommand(c_input, c_output, c_format);
     else if (*e_app)
-        RunExtractCommand(e_input, e_output, e_format);
+        RunExtractCommand(e_input, e_output, e_format, e_jobs, e_filter);
+    else if (*l_app)
+        RunListCommand(l_input, l_json);
     else if (*d_app)
         RunDiskCommand(d_folder, d_output, d_name);
 }
@@ -25,7 +25,7 @@ this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "stuffit/methods/arsenic.h"
 
 #include <make_unique.hpp>
-#include <stdlib.h>
+#include <algorithm>
 
 namespace maconv {
 namespace stuffit {
@@ -52,47 +52,61 @@ CompMethodPtr GetCompressionMethod(uint8_t method)
 }
 
 
+// Get the name of a compression method (without creating it).
+std::string GetCompressionMethodName(uint8_t method)
+{
+    switch (method) {
+        case 0: return "none";
+        case 1: return "rle90";
+        case 2: return "lzw";
+        case 13: return "algo13";
+        case 15: return "arsenic";
+        default: return "method" + std::to_string(method);
+    }
+}
 
-// Extract data from the compressed fork.
+
+
+// Extract data from the compressed fork (chunk by chunk, into |sink|).
 void CompressionMethod::Extract(const StuffitCompInfo &info, uint8_t *data,
-    std::vector<fs::DataPtr> &mem_pool)
+    ForkSink &sink)
 {
-    uint32_t capacity = info.size ? info.size : info.comp_size;
     this->data = data + info.offset;
     this->end = this->data + info.comp_size;
 
     Initialize();
-    std::unique_ptr<uint8_t[]> buffer;
-
-    buffer.reset((uint8_t *)malloc(capacity));
+    auto buffer = std::make_unique<uint8_t[]>(kChunkSize);
     total_size = 0;
 
-    // Uncompress the data chunk by chunks.
-    for (uint32_t len = 0; true;) {
-        len = ReadBytes(buffer.get() + total_size, capacity - total_size);
-        if (len == -1)
-            break;
+    // Uncompress the data chunk by chunk: fill the chunk and give it to
+    // the sink (a chunk is given early if the next output doesn't fit).
+    for (bool ended = false; !ended;) {
+        uint32_t filled = 0;
+
+        while (filled < kChunkSize) {
+            int32_t len = ReadBytes(buffer.get() + filled, kChunkSize - filled);
+            if (len == -1) { ended = true; break; }
+            if (len == 0) break;
 
-        total_size += len;
-        if (len == 0 || total_size == capacity) {
-            capacity = (capacity * 3) / 2;
-            buffer.reset((uint8_t *)realloc((void *)buffer.release(), capacity));
+            filled += len;
+            total_size += len;
         }
-    }
 
-    // Store the uncompressed buffer in the mempool.
-    uncompressed = buffer.get();
-    mem_pool.emplace_back(std::move(buffer));
+        if (!ended && filled == 0)
+            throw ExtractException("output doesn't fit in a chunk");
+        if (filled != 0)
+            sink.Write(buffer.get(), filled);
+    }
 }
 
 
 
 // Extract data from the compressed fork.
 void NoneMethod::Extract(const StuffitCompInfo &info, uint8_t *data,
-    std::vector<fs::DataPtr> &mem_pool)
+    ForkSink &sink)
 {
-    total_size = info.size ? info.size : info.comp_size;
-    uncompressed = data + info.offset;
+    total_size = info.size ? std::min(info.size, info.comp_size) : info.comp_size;
+    sink.Write(data + info.offset, total_size);
 }
 
 
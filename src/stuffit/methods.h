@@ -40,6 +40,21 @@ struct ExtractException : std::exception {
 
 
 
+// Receive uncompressed data of a fork, chunk by chunk.
+struct ForkSink {
+
+    virtual ~ForkSink() = default;
+
+    // Write a chunk of uncompressed data (return the number of bytes kept).
+    virtual uint32_t Write(uint8_t *data, uint32_t length) = 0;
+};
+
+
+
+// Size of the chunks given to a fork sink.
+constexpr uint32_t kChunkSize = 64 * 1024;
+
+
 // A compression method.
 struct CompressionMethod {
 
@@ -53,15 +68,17 @@ struct CompressionMethod {
     virtual void Initialize() {}
 
 
-    // Extract data from the compressed fork.
+    // Extract data from the compressed fork (chunk by chunk, into |sink|).
     virtual void Extract(const StuffitCompInfo &info, uint8_t *data,
-        std::vector<fs::DataPtr> &mem_pool);
+        ForkSink &sink);
+
+    // Check the CRC once extracted (|crc| is the CRC-16 of the output).
+    virtual bool CheckCRC(const StuffitCompInfo &info, uint16_t crc) { return crc == info.crc; }
 
     uint8_t *data; // Compressed data.
     uint8_t *end; // End of compressed data.
 
-    uint8_t *uncompressed; // Pointer on t uncompressed data.
-    uint32_t total_size; // Length of uncompressed data.
+    uint32_t total_size; // Length of uncompressed data (so far).
 };
 
 
@@ -72,6 +89,9 @@ using CompMethodPtr = std::unique_ptr<CompressionMethod>;
 // Get a compression method (from a method number).
 CompMethodPtr GetCompressionMethod(uint8_t method);
 
+// Get the name of a compression method (without creating it).
+std::string GetCompressionMethodName(uint8_t method);
+
 
 
 // "No compression" method.
@@ -79,7 +99,7 @@ struct NoneMethod : CompressionMethod {
 
     // Extract data from the compressed fork.
     void Extract(const StuffitCompInfo &info, uint8_t *data,
-        std::vector<fs::DataPtr> &mem_pool) override;
+        ForkSink &sink) override;
 };
 
 
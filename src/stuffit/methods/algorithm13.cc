@@ -316,45 +316,84 @@ constexpr int kLzssEnd = -2;
 
 
 
+// Built-in codes (made once, then shared by all the instances).
+struct Algorithm13Codes {
+
+    Algorithm13Codes()
+    {
+        metacode.Initialize();
+        for (int i = 0; i < 37; i++)
+            metacode.AddValueLF(i, kMetaCodes[i], kMetaCodeLengths[i]);
+        metacode.MakeTable(true);
+
+        for (int i = 0; i < 5; i++) {
+            firstcode[i].Initialize(kFirstCodeLengths[i], 321, 32, true);
+            secondcode[i].Initialize(kSecondCodeLengths[i], 321, 32, true);
+            offsetcode[i].Initialize(kOffsetCodeLengths[i], kOffsetCodeSize[i], 32, true);
+
+            firstcode[i].MakeTable(true, 0x100);
+            secondcode[i].MakeTable(true);
+            offsetcode[i].MakeTable(true);
+        }
+    }
+
+    HuffmanDecoder metacode;
+    HuffmanDecoder firstcode[5], secondcode[5], offsetcode[5];
+};
+
+
+// Get the built-in codes (they are made on first use).
+static const Algorithm13Codes &GetAlgorithm13Codes()
+{
+    static const Algorithm13Codes codes;
+    return codes;
+}
+
+
+
 // Intialize LZSS.
 void Algorithm13Method::InitializeLZSS()
 {
+    const Algorithm13Codes &codes = GetAlgorithm13Codes();
+
     int val = *(input.data++);
     int code = ((val & 0xFF) >> 4);
 
     if (code == 0) {
-        HuffmanDecoder metacode;
-        metacode.Initialize();
+        // Two litterals in a row are decoded with the first code.
+        ParseHuffmanCode(dyn_firstcode, 321, codes.metacode);
+        dyn_firstcode.MakeTable(true, 0x100);
+        firstcode = &dyn_firstcode;
 
-        for (int i = 0; i < 37; i++)
-            metacode.AddValueLF(i, kMetaCodes[i], kMetaCodeLengths[i]);
-        metacode.MakeTable(true);
+        if (val & 0x08) {
+            secondcode = &dyn_firstcode;
+        } else {
+            ParseHuffmanCode(dyn_secondcode, 321, codes.metacode);
+            dyn_secondcode.MakeTable(true);
+            secondcode = &dyn_secondcode;
+        }
 
-        ParseHuffmanCode(firstcode, 321, metacode);
-        if (val & 0x08) secondcode = firstcode;
-        else ParseHuffmanCode(secondcode, 321, metacode);
-        ParseHuffmanCode(offsetcode, (val & 0x07) + 10, metacode);
+        ParseHuffmanCode(dyn_offsetcode, (val & 0x07) + 10, codes.metacode);
+        dyn_offsetcode.MakeTable(true);
+        offsetcode = &dyn_offsetcode;
     }
     else if (code < 6) {
-        firstcode.Initialize(kFirstCodeLengths[code-1], 321, 32, true);
-        secondcode.Initialize(kSecondCodeLengths[code-1], 321, 32, true);
-        offsetcode.Initialize(kOffsetCodeLengths[code-1], kOffsetCodeSize[code-1], 32, true);
+        firstcode = &codes.firstcode[code-1];
+        secondcode = &codes.secondcode[code-1];
+        offsetcode = &codes.offsetcode[code-1];
     }
     else {
         throw ExtractException("Algo13: invalid compressed data [code]");
     }
 
-    currcode = &firstcode;
-    firstcode.MakeTable(true);
-    secondcode.MakeTable(true);
-    offsetcode.MakeTable(true);
+    currcode = firstcode;
 }
 
 
 
 // Parse code of size.
 void Algorithm13Method::ParseHuffmanCode(HuffmanDecoder &decoder, int numcodes,
-    HuffmanDecoder &metacode)
+    const HuffmanDecoder &metacode)
 {
     int length = 0;
     int lengths[numcodes];
@@ -388,26 +427,32 @@ void Algorithm13Method::ParseHuffmanCode(HuffmanDecoder &decoder, int numcodes,
 
 
 
-// Get the next litteral or offset.
-int Algorithm13Method::NextLiteralOrOffset(int &offset, int &length)
+// Get the next litterals (written in |out|) or offset.
+// Return the number of litterals, kLzssMatch or kLzssEnd.
+int Algorithm13Method::NextLiteralsOrOffset(uint8_t *out, int &offset, int &length)
 {
     if (input.HasEnded())
         throw ExtractException("Algo13: all data read but algo has not finished");
-    int val = currcode->NextSymbol(input);
+
+    int symbols[2];
+    int count = currcode->NextSymbols(input, symbols);
+    int val = symbols[0];
 
     if (val < 0x100) {
-        currcode = &firstcode;
-        return val;
+        currcode = firstcode;
+        out[0] = val;
+        out[1] = symbols[1]; // Only kept if there are two litterals.
+        return count;
     }
     else {
-        currcode = &secondcode;
+        currcode = secondcode;
 
         if (val < 0x13E) length = val - 0x100 + 3;
         else if (val == 0x13E) length = input.ReadWord(10) + 65;
         else if (val == 0x13F) length = input.ReadWord(15) + 65;
         else return kLzssEnd;
 
-        int bit_length = offsetcode.NextSymbol(input);
+        int bit_length = offsetcode->NextSymbol(input);
         if (bit_length == 0) offset = 1;
         else if (bit_length == 1) offset = 2;
         else offset = (1 << (bit_length-1)) + input.ReadWord(bit_length-1) + 1;
@@ -418,67 +463,93 @@ int Algorithm13Method::NextLiteralOrOffset(int &offset, int &length)
 
 
 
+// Size of the window (the maximal offset of a match).
+constexpr uint32_t kWindowSize = 65536;
 
-// Constants.
-constexpr int kWindowSize = 65536;
-constexpr int kWindowMask = kWindowSize - 1;
+// Size of the output given to the sink at once.
+constexpr uint32_t kOutputSize = 1 << 20;
+
+// Maximal length of a match.
+constexpr uint32_t kMaxMatchLength = (1 << 15) - 1 + 65;
 
 
 // Initialize the algorithm.
 void Algorithm13Method::Initialize()
 {
-    ended = false;
     input.Load(data, end - data);
-    window_buffer = std::make_unique<uint8_t[]>(kWindowSize);
-
-    match_length = 0; match_offset = 0;
-    memset(window_buffer.get(), 0, kWindowSize);
-
     InitializeLZSS();
 }
 
 
 
-// Read the next byte.
-int32_t Algorithm13Method::ReadNextByte(uint32_t pos)
+// Copy a match (the source may overlap the destination).
+static inline void CopyMatch(uint8_t *out, uint32_t offset, uint32_t length)
+{
+    const uint8_t *src = out - offset;
+
+    if (offset >= length)
+        return (void)memcpy(out, src, length);
+
+    // Copy by words while the source is far enough (already written).
+    if (offset >= 8) {
+        for (; length >= 8; length -= 8, out += 8, src += 8)
+            memcpy(out, src, 8);
+    }
+
+    while (length--)
+        *(out++) = *(src++);
+}
+
+
+// Decode symbols into |out| until |out_end| is (nearly) reached.
+// Return false if the end of data has been reached.
+bool Algorithm13Method::DecodeBlock(uint8_t *&out, uint8_t *out_end)
 {
-    if (!match_length) {
-        int offset, length;
-        int val = NextLiteralOrOffset(offset, length);
+    while (out + kMaxMatchLength <= out_end) {
+        int offset = 0, length = 0;
+        int val = NextLiteralsOrOffset(out, offset, length);
 
         if (val >= 0) {
-            window_buffer[pos & kWindowMask] = val;
-            return val;
-        } else if (val == kLzssEnd) {
-            ended = true;
-            return -1;
+            out += val;
+        } else if (val == kLzssMatch) {
+            CopyMatch(out, offset, length);
+            out += length;
         } else {
-            match_length = length;
-            match_offset = pos - offset;
+            return false;
         }
     }
 
-    match_length--;
-    uint8_t byte = window_buffer[match_offset++ & kWindowMask];
-    window_buffer[pos & kWindowMask] = byte;
-    return byte;
+    return true;
 }
 
 
-
-// Read the next bytes.
-int32_t Algorithm13Method::ReadBytes(uint8_t *buffer, uint32_t length)
+// Extract data from the compressed fork (chunk by chunk, into |sink|).
+// Data is decoded just after a copy of the last |kWindowSize| bytes, so
+// matches are copied from the output (the window is zeros at start).
+void Algorithm13Method::Extract(const StuffitCompInfo &info, uint8_t *data,
+    ForkSink &sink)
 {
-    if (ended) return -1;
+    this->data = data + info.offset;
+    this->end = this->data + info.comp_size;
+    Initialize();
+
+    auto buffer = std::make_unique<uint8_t[]>(kWindowSize + kOutputSize);
+    memset(buffer.get(), 0, kWindowSize);
 
-    uint8_t *start = buffer;
-    uint8_t *end_capacity = buffer + length;
+    uint8_t *start = buffer.get() + kWindowSize;
+    uint8_t *buffer_end = start + kOutputSize;
+    total_size = 0;
 
-    int32_t byte;
-    while (buffer != end_capacity && (byte = ReadNextByte(total_size + (buffer - start))) != -1)
-        *(buffer++) = byte;
+    for (bool more = true; more;) {
+        uint8_t *out = start;
+        more = DecodeBlock(out, buffer_end);
 
-    return buffer - start;
+        sink.Write(start, out - start);
+        total_size += out - start;
+
+        // Keep the last |kWindowSize| bytes for the next matches.
+        memmove(buffer.get(), out - kWindowSize, kWindowSize);
+    }
 }
 
 
@@ -40,30 +40,32 @@ struct Algorithm13Method : CompressionMethod {
 
     // Parse Huffman code given in data.
     void ParseHuffmanCode(HuffmanDecoder &decoder, int numcodes,
-        HuffmanDecoder &metacode);
+        const HuffmanDecoder &metacode);
 
-    // Get the next litteral or offset.
-    int NextLiteralOrOffset(int &offset, int &length);
+    // Get the next litterals (written in |out|) or offset.
+    // Return the number of litterals, kLzssMatch or kLzssEnd.
+    int NextLiteralsOrOffset(uint8_t *out, int &offset, int &length);
 
 
     // Initialize the algorithm.
     void Initialize() override;
 
-    // Read the next byte.
-    int32_t ReadNextByte(uint32_t pos);
+    // Decode symbols into |out| until |out_end| is (nearly) reached.
+    // Return false if the end of data has been reached.
+    bool DecodeBlock(uint8_t *&out, uint8_t *out_end);
 
-    // Read the next bytes.
-    int32_t ReadBytes(uint8_t *data, uint32_t length) override;
+    // Extract data from the compressed fork (chunk by chunk, into |sink|).
+    void Extract(const StuffitCompInfo &info, uint8_t *data,
+        ForkSink &sink) override;
 
 
-    bool ended;
     utils::BitReaderLE input;
 
-    std::unique_ptr<uint8_t[]> window_buffer;
-    int match_length, match_offset;
+    // Codes given in data (unused with built-in codes).
+    HuffmanDecoder dyn_firstcode, dyn_secondcode, dyn_offsetcode;
 
-    HuffmanDecoder firstcode, secondcode, offsetcode;
-    HuffmanDecoder *currcode;
+    const HuffmanDecoder *firstcode, *secondcode, *offsetcode;
+    const HuffmanDecoder *currcode;
 };
 
 
@@ -25,6 +25,8 @@ this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "commands.h"
 
 #include <make_unique.hpp>
+#include <algorithm>
+#include <system_error>
 #include <string.h>
 
 namespace maconv {
@@ -77,11 +79,11 @@ void ArithmeticModel::Initialize(int first_symbol, int last_symbol, int incremen
 {
     this->increment = increment;
     this->freq_limit = frequency_limit;
+    this->first_symbol = first_symbol;
     this->num_symbols = last_symbol - first_symbol + 1;
+    this->num_blocks = (num_symbols + kModelBlockSize - 1) / kModelBlockSize;
 
     ResetModel();
-    for (int i = 0; i < num_symbols; i++)
-        symbols[i].symbol = i + first_symbol;
 }
 
 
@@ -90,14 +92,51 @@ void ArithmeticModel::ResetModel()
 {
     total_freq = increment * num_symbols;
     for (int i = 0; i < num_symbols; i++)
-        symbols[i].freq = increment;
+        freqs[i] = increment;
+
+    SumBlocks();
+}
+
+
+// Compute the frequencies of the blocks.
+void ArithmeticModel::SumBlocks()
+{
+    for (int i = 0; i < num_blocks; i++)
+        block_freqs[i] = 0;
+    for (int i = 0; i < num_symbols; i++)
+        block_freqs[i / kModelBlockSize] += freqs[i];
+}
+
+
+// Find the index of the symbol at cumulative frequency |freq|.
+// Set |low| to the cumulative frequency of the symbols before it.
+int ArithmeticModel::FindSymbol(int freq, int &low) const
+{
+    int block = 0;
+    low = 0;
+
+    for (; block < num_blocks - 1; block++) {
+        if (low + block_freqs[block] > freq) break;
+        low += block_freqs[block];
+    }
+
+    int n = block * kModelBlockSize;
+    int last = std::min(n + kModelBlockSize, num_symbols) - 1;
+
+    for (; n < last; n++) {
+        if (low + freqs[n] > freq) break;
+        low += freqs[n];
+    }
+
+    return n;
 }
 
 
 // Increase the model frequency at |symindex| by |increment|.
 void ArithmeticModel::IncreaseFrequency(int symindex)
 {
-    symbols[symindex].freq += increment;
+    freqs[symindex] += increment;
+    block_freqs[symindex / kModelBlockSize] += increment;
 
     total_freq += increment;
     if (total_freq <= freq_limit)
@@ -105,10 +144,12 @@ void ArithmeticModel::IncreaseFrequency(int symindex)
 
     total_freq = 0;
     for (int i = 0; i < num_symbols; i++) {
-        symbols[i].freq++;
-        symbols[i].freq >>= 1;
-        total_freq += symbols[i].freq;
+        freqs[i]++;
+        freqs[i] >>= 1;
+        total_freq += freqs[i];
     }
+
+    SumBlocks();
 }
 
 
@@ -118,45 +159,70 @@ constexpr int kDecoderNumBits = 26;
 constexpr int kDecoderOne = (1 << (kDecoderNumBits - 1));
 constexpr int kDecoderHalf = (1 << (kDecoderNumBits - 2));
 
+// Maximal total frequency of a model (the highest limit is 1024 + 8).
+constexpr int kMaxTotalFreq = 2048;
+
+
+// Reciprocals of the total frequencies: range / total is computed as
+// (range * reciprocal) >> 37. This is exact as range < 2^26 and
+// total < 2^11 (so range * total < 2^37), and doesn't overflow.
+struct ReciprocalTable {
+
+    ReciprocalTable()
+    {
+        for (int total = 1; total < kMaxTotalFreq; total++)
+            values[total] = ((uint64_t)1 << 37) / total + 1;
+    }
+
+    uint64_t values[kMaxTotalFreq];
+};
+
+static const ReciprocalTable kReciprocals;
+
+
 
 // Initialize the decoder with some values.
 void ArithmeticDecoder::Initialize(uint8_t *data, uint32_t length)
 {
     input.Load(data, length);
     range = kDecoderOne;
-    code = input.ReadLongWord(kDecoderNumBits);
+    code = input.ReadWord(kDecoderNumBits);
 }
 
 
-// Get the next arithmetic code.
-void ArithmeticDecoder::NextCode(int symlow, int symsize, int symtot)
+// Get the next arithmetic code (|renormf| is range / symtot).
+void ArithmeticDecoder::NextCode(int symlow, int symsize, int symtot, int renormf)
 {
-    int renormf = range / symtot;
     int lowincr = renormf * symlow;
 
     code -= lowincr;
     range = (symlow + symsize == symtot) ? (range - lowincr) : (symsize * renormf);
 
-    for (; range <= kDecoderHalf; range <<= 1)
-        code = (code << 1) | input.ReadBit();
+    // Renormalize: read all the new bits at once.
+    if (range <= kDecoderHalf) {
+        int n = __builtin_clz(range) - __builtin_clz(kDecoderHalf);
+        if ((range << n) == kDecoderHalf) n++;
+
+        code = (code << n) | input.ReadWord(n);
+        range <<= n;
+    }
 }
 
 
 // Get the next arithmetic symbol.
 int ArithmeticDecoder::NextSymbol(ArithmeticModel *model)
 {
-    int freq = code / (range / model->total_freq);
-    int cumulative = 0, n = 0;
+    int total = model->total_freq;
+    int renormf = (range * kReciprocals.values[total]) >> 37;
 
-    for (; n < model->num_symbols - 1; n++) {
-        if (cumulative + model->symbols[n].freq > freq) break;
-        cumulative += model->symbols[n].freq;
-    }
+    // Codes past the last symbol (rounding) belong to the last symbol.
+    int freq = std::min(code / renormf, total - 1);
 
-    NextCode(cumulative, model->symbols[n].freq, model->total_freq);
+    int low, n = model->FindSymbol(freq, low);
+    NextCode(low, model->freqs[n], total, renormf);
     model->IncreaseFrequency(n);
 
-    return model->symbols[n].symbol;
+    return model->first_symbol + n;
 }
 
 
@@ -175,6 +241,12 @@ int ArithmeticDecoder::NextWord(ArithmeticModel *model, int n)
 
 
 
+// Smallest blocks read on another thread (64 KB): smaller blocks are read
+// too fast for the pipeline to pay for starting a thread.
+constexpr int kMinPipelinedBlockBits = 16;
+
+
+
 // Initialize the algorithm.
 void ArsenicMethod::Initialize()
 {
@@ -201,20 +273,30 @@ void ArsenicMethod::Initialize()
     num_bytes = 0; byte_count = 0; repeat = 0;
     crc = 0xFFFFFFFF; compcrc = 0;
 
-    block = std::make_unique<uint8_t[]>(block_size);
+    transform = std::make_unique<uint32_t[]>(block_size);
+    next_block = 0;
+
+    // The first block is read when needed, there is nothing to overlap.
     end_of_blocks = decoder.NextSymbol(&initial_model); // Check first end marker.
+    if (!end_of_blocks)
+        StartNextBlock(std::launch::deferred);
 }
 
 
 
-// Read the next block.
-void ArsenicMethod::ReadNextBlock()
+// Read the next block into |out| (arithmetic and MTF stages).
+void ArsenicMethod::ReadNextBlock(ArsenicBlock &out)
 {
+    if (!out.data)
+        out.data = std::make_unique<uint8_t[]>(block_size);
+
+    uint8_t *block = out.data.get();
+    int num_bytes = 0;
+
     mtf.ResetDecoder();
 
-    randomized = decoder.NextSymbol(&initial_model);
-    transform_index = decoder.NextWord(&initial_model, block_bits);
-    num_bytes = 0;
+    out.randomized = decoder.NextSymbol(&initial_model);
+    out.transform_index = decoder.NextWord(&initial_model, block_bits);
 
     while (true) {
         int sel = decoder.NextSymbol(&selector_model);
@@ -244,20 +326,64 @@ void ArsenicMethod::ReadNextBlock()
         block[num_bytes++] = mtf.Decode(symbol);
     }
 
-    if (transform_index >= num_bytes)
+    if (out.transform_index >= num_bytes)
         throw ExtractException("Arsenic: invalid block [transform index]");
 
+    out.num_bytes = num_bytes;
+
     selector_model.ResetModel();
     for (int i = 0; i < 7;i++)
         mtf_model[i].ResetModel();
 
-    if (decoder.NextSymbol(&initial_model)) { // End marker.
+    out.is_last = decoder.NextSymbol(&initial_model); // End marker.
+    if (out.is_last)
         compcrc = decoder.NextWord(&initial_model, 32);
-        end_of_blocks = true;
+}
+
+
+// Start reading the next block (with launch |policy|).
+void ArsenicMethod::StartNextBlock(std::launch policy)
+{
+    ArsenicBlock *out = &blocks[next_block];
+    auto read = [this, out]() { ReadNextBlock(*out); };
+
+    // If no thread can be started, the block is read when needed.
+    try {
+        next_block_read = std::async(policy, read);
+    } catch (std::system_error &) {
+        next_block_read = std::async(std::launch::deferred, read);
     }
+}
+
+
+// Wait for the next block and undo its BWT.
+void ArsenicMethod::UnpackNextBlock()
+{
+    next_block_read.get(); // Rethrow the errors of the block.
+
+    ArsenicBlock &current = blocks[next_block];
+    next_block ^= 1;
+
+    end_of_blocks = current.is_last;
+    if (!end_of_blocks && block_bits >= kMinPipelinedBlockBits)
+        StartNextBlock(std::launch::async);
+    else if (!end_of_blocks)
+        StartNextBlock(std::launch::deferred);
+
+    block = current.data.get();
+    num_bytes = current.num_bytes;
 
-    transform = std::make_unique<uint32_t[]>(num_bytes);
-    CalculateInverseBWT(transform.get(), block.get(), num_bytes);
+    CalculateInverseBWT(transform.get(), block, num_bytes);
+    ApplyInverseBWT(transform.get(), block, num_bytes, current.transform_index);
+
+    if (current.randomized) { // Undo the randomization.
+        int rand_index = 0;
+        for (int i = kRandomizationTable[0]; i < num_bytes;) {
+            block[i] ^= 1;
+            rand_index = (rand_index + 1) & 0xFF;
+            i += kRandomizationTable[rand_index];
+        }
+    }
 }
 
 
@@ -268,29 +394,19 @@ int32_t ArsenicMethod::ReadNextByte()
     int byte, out_byte;
 
     if (repeat) {
-        out_byte = last; repeat--;
-        goto end;
+        repeat--;
+        return last;
     }
 
 retry:
     if (byte_count >= num_bytes) {
         if (end_of_blocks) return -1;
 
-        ReadNextBlock();
+        UnpackNextBlock();
         byte_count = 0; count = 0; last = 0;
-        rand_index = 0; rand_count = kRandomizationTable[0];
-    }
-
-    transform_index = transform[transform_index];
-    byte = block[transform_index];
-
-    if (randomized && rand_count == byte_count) {
-        byte ^= 1;
-        rand_index = (rand_index + 1) & 0xFF;
-        rand_count += kRandomizationTable[rand_index];
     }
 
-    byte_count++;
+    byte = block[byte_count++];
 
     if (count == 4) {
         count = 0;
@@ -304,8 +420,6 @@ retry:
         out_byte = byte;
     }
 
-end:
-    crc = CalcCRC(crc, out_byte, CRCTable_edb88320);
     return out_byte;
 }
 
@@ -314,12 +428,6 @@ end:
 // Read the next bytes.
 int32_t ArsenicMethod::ReadBytes(uint8_t *buffer, uint32_t length)
 {
-    if (end_of_blocks) {
-        // if (compcrc != ~crc)  // FIX ME
-        //     throw ExtractException("Arsenic: invalid CRC after uncompressing");
-        return -1;
-    }
-
     uint8_t *start = buffer;
     uint8_t *end_capacity = buffer + length;
 
@@ -327,10 +435,22 @@ int32_t ArsenicMethod::ReadBytes(uint8_t *buffer, uint32_t length)
     while (buffer != end_capacity && (byte = ReadNextByte()) != -1)
         *(buffer++) = byte;
 
+    // The last block may still have bytes after |end_of_blocks| is set.
+    if (buffer == start && end_of_blocks)
+        return -1;
+
+    crc = CalcCRC32(crc, start, buffer - start);
     return buffer - start;
 }
 
 
+// Check the CRC once extracted (Arsenic has its own CRC-32).
+bool ArsenicMethod::CheckCRC(const StuffitCompInfo &, uint16_t)
+{
+    return compcrc == ~crc;
+}
+
+
 
 } // namespace stuffit
 } // namespace maconv
@@ -28,20 +28,19 @@ this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "stuffit/utils/crc.h"
 #include "utils/bit_reader.h"
 
+#include <future>
 #include <memory>
 
 namespace maconv {
 namespace stuffit {
 
 
-// Store an arithmetic symbol.
-struct ArithmeticSymbol {
-    int symbol;
-    int freq;
-};
-
+// Number of symbols in a block of the arithmetic model.
+constexpr int kModelBlockSize = 16;
 
 // The arithmetic model.
+// Frequencies are summed by blocks of |kModelBlockSize| symbols: finding a
+// symbol from a cumulative frequency skips whole blocks first.
 struct ArithmeticModel {
 
     // Initialize the model with some values.
@@ -50,15 +49,26 @@ struct ArithmeticModel {
     // Reset the model.
     void ResetModel();
 
+    // Find the index of the symbol at cumulative frequency |freq|.
+    // Set |low| to the cumulative frequency of the symbols before it.
+    int FindSymbol(int freq, int &low) const;
+
     // Increase the model frequency at |symindex| by |increment|.
     void IncreaseFrequency(int symindex);
 
+    // Compute the frequencies of the blocks.
+    void SumBlocks();
+
     int total_freq;
     int increment;
     int freq_limit;
 
+    int first_symbol;
     int num_symbols;
-    ArithmeticSymbol symbols[128];
+    int num_blocks;
+
+    int freqs[128];
+    int block_freqs[128 / kModelBlockSize];
 };
 
 
@@ -68,8 +78,8 @@ struct ArithmeticDecoder {
     // Initialize the decoder with some values.
     void Initialize(uint8_t *data, uint32_t length);
 
-    // Get the next arithmetic code.
-    void NextCode(int symlow, int symsize, int symtot);
+    // Get the next arithmetic code (|renormf| is range / symtot).
+    void NextCode(int symlow, int symsize, int symtot, int renormf);
 
     // Get the next arithmetic symbol.
     int NextSymbol(ArithmeticModel *model);
@@ -83,14 +93,33 @@ struct ArithmeticDecoder {
 
 
 
+// A block read by the arithmetic and MTF stages.
+struct ArsenicBlock {
+    std::unique_ptr<uint8_t[]> data;
+    int num_bytes, transform_index;
+    int randomized;
+    bool is_last;
+};
+
+
+
 // Arsenic compression algorithm.
+// Blocks of 64 KB or more are pipelined: the next block is read (arithmetic
+// and MTF stages) on another thread while the current one is output (BWT and
+// RLE stages).
 struct ArsenicMethod : CompressionMethod {
 
     // Initialize the algorithm.
     void Initialize() override;
 
-    // Read the next block.
-    void ReadNextBlock();
+    // Read the next block into |out| (arithmetic and MTF stages).
+    void ReadNextBlock(ArsenicBlock &out);
+
+    // Start reading the next block (with launch |policy|).
+    void StartNextBlock(std::launch policy);
+
+    // Wait for the next block and undo its BWT.
+    void UnpackNextBlock();
 
 
     // Read the next byte.
@@ -99,22 +128,28 @@ struct ArsenicMethod : CompressionMethod {
     // Read the next bytes.
     int32_t ReadBytes(uint8_t *data, uint32_t length) override;
 
+    // Check the CRC once extracted (Arsenic has its own CRC-32).
+    bool CheckCRC(const StuffitCompInfo &info, uint16_t crc16) override;
+
 
     ArithmeticModel initial_model, selector_model, mtf_model[7];
     ArithmeticDecoder decoder;
     MtfDecoder mtf;
 
-    std::unique_ptr<uint8_t[]> block;
     int block_bits, block_size;
-    bool end_of_blocks;
+    ArsenicBlock blocks[2];
+    int next_block;
 
-    int num_bytes, byte_count, transform_index;
+    uint8_t *block;
+    int num_bytes, byte_count;
+    bool end_of_blocks;
     std::unique_ptr<uint32_t[]> transform;
 
-    int randomized, rand_count, rand_index;
     int repeat, count, last;
-
     uint32_t crc, compcrc;
+
+    // Must be destroyed first (it waits for the thread using the fields above).
+    std::future<void> next_block_read;
 };
 
 
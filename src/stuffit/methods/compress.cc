@@ -24,23 +24,35 @@ this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "stuffit/methods/compress.h"
 
 #include <make_unique.hpp>
+#include <algorithm>
+#include <cstring>
 
 namespace maconv {
 namespace stuffit {
 
 
 
+// Number of bytes kept in the output history when it's full.
+constexpr uint32_t kHistoryKeep = 1 << 20;
+
+
+
 // Initialize the decoder.
 void CompressLzw::Initialize(int max_symbols, int reserved_symbols)
 {
     this->max_symbols = max_symbols;
     this->reserved_symbols = reserved_symbols;
 
-    nodes = std::make_unique<CompressTreeNode[]>(max_symbols);
-    for (int i = 0; i < 256; i++) {
-        nodes[i].chr = i;
-        nodes[i].parent = -1;
-    }
+    entries = std::make_unique<CompressEntry[]>(max_symbols);
+    for (int i = 0; i < 256; i++)
+        entries[i] = CompressEntry { 0, 1, -1, (uint8_t)i };
+
+    // A string is never longer than the number of symbols.
+    history_size = 2 * kHistoryKeep + max_symbols;
+    history = std::make_unique<uint8_t[]>(history_size);
+    history_base = 0;
+    history_end = 0;
+    history_read = 0;
 
     ClearTable();
 }
@@ -56,60 +68,83 @@ void CompressLzw::ClearTable()
 
 
 
-// The the first bytes corresponding to symbol in the LZW tree.
-uint8_t CompressLzw::FindFirstByte(int symbol)
+// Discard old output (the most recent output is kept).
+void CompressLzw::SlideHistory()
 {
-    while (nodes[symbol].parent >= 0)
-        symbol = nodes[symbol].parent;
-    return nodes[symbol].chr;
+    uint32_t shift = std::min(history_end - kHistoryKeep, history_read);
+    memmove(history.get(), history.get() + shift, history_end - shift);
+
+    history_base += shift;
+    history_end -= shift;
+    history_read -= shift;
 }
 
 
-// Get the next symbol.
-void CompressLzw::NextSymbol(int symbol)
+// Write the string of a symbol at |out| (return its length).
+uint32_t CompressLzw::WriteString(int symbol, uint8_t *out)
 {
-    if (symbol > num_symbols || (prev_symbol < 0 && symbol == num_symbols))
-        throw ExtractException("Compress: invalid code");
-
-    int parent = prev_symbol;
-    prev_symbol = symbol;
+    if (symbol < 256)
+        return (*out = symbol, 1);
+
+    // The string is still in the history: copy it.
+    const CompressEntry &entry = entries[symbol];
+    if (entry.pos >= history_base) {
+        memcpy(out, history.get() + (entry.pos - history_base), entry.len);
+        return entry.len;
+    }
 
-    if (parent < 0) return;
-    int postfix_byte = FindFirstByte(symbol == num_symbols ? parent : symbol);
+    // Else, rebuild it from the table (from its last byte).
+    uint32_t i = entry.len;
+    for (int s = symbol; s >= 0; s = entries[s].parent)
+        out[--i] = entries[s].chr;
+    return entry.len;
+}
 
-    if (num_symbols == max_symbols) // Too many symbols.
-        return;
 
-    nodes[num_symbols].parent = parent;
-    nodes[num_symbols].chr = postfix_byte;
-    num_symbols++;
+// Decode the next symbol (its string is added to the output history).
+void CompressLzw::NextSymbol(int symbol)
+{
+    if (symbol > num_symbols || (prev_symbol < 0 && symbol == num_symbols))
+        throw ExtractException("Compress: invalid code");
 
-    if (num_symbols != max_symbols && ((num_symbols & (num_symbols-1)) == 0))
-        symbol_size++;
-}
+    if (history_end + max_symbols > history_size)
+        SlideHistory();
+
+    uint64_t pos = history_base + history_end;
+    uint8_t *out = history.get() + history_end;
+    uint32_t len;
+
+    // The symbol is being defined: it's the previous string plus its
+    // first byte (the previous string is just before |out|).
+    if (symbol == num_symbols) {
+        memcpy(out, out - prev_len, prev_len);
+        out[prev_len] = out[0];
+        len = prev_len + 1;
+    } else {
+        len = WriteString(symbol, out);
+    }
 
+    // Add the previous string plus the first byte of this one.
+    if (prev_symbol >= 0 && num_symbols != max_symbols) {
+        entries[num_symbols] = CompressEntry { prev_pos, prev_len + 1, prev_symbol, out[0] };
+        num_symbols++;
 
+        if (num_symbols != max_symbols && ((num_symbols & (num_symbols-1)) == 0))
+            symbol_size++;
+    }
 
-// Calculate the number of bytes needed to write the output.
-int CompressLzw::CalcOutputLength()
-{
-    int n = 0;
-    for (int symbol = prev_symbol; symbol >= 0; n++)
-        symbol = nodes[symbol].parent;
-    return n;
+    prev_symbol = symbol;
+    prev_pos = pos;
+    prev_len = len;
+    history_end += len;
 }
 
 
-// Write the ouput data to a buffer.
-void CompressLzw::OutputToBuffer(int len, uint8_t *buffer)
+// Read |len| decoded bytes.
+void CompressLzw::ReadOutput(uint8_t *data, uint32_t len)
 {
-    int symbol = prev_symbol;
-    buffer += len;
-
-    while (symbol >= 0) {
-        *(--buffer) = nodes[symbol].chr;
-        symbol = nodes[symbol].parent;
-    }
+    memcpy(data, history.get() + history_read, len);
+    history_read += len;
 }
 
 
@@ -122,13 +157,13 @@ void CompressMethod::Initialize()
     lzw.Initialize(1 << (flags & 0x1F), block_mode ? 1 : 0);
 
     input.Load(data, end - data);
-    output_len = -1;
+    input_ended = false;
     symbol_counter = 0;
 }
 
 
 
-// Load the next block of data.
+// Load and decode the next symbol.
 bool CompressMethod::LoadNextBlock()
 {
     int symbol;
@@ -147,7 +182,6 @@ bool CompressMethod::LoadNextBlock()
     }
 
     lzw.NextSymbol(symbol);
-    output_len = lzw.CalcOutputLength();
     return true;
 }
 
@@ -156,15 +190,18 @@ bool CompressMethod::LoadNextBlock()
 // Read the next bytes.
 int32_t CompressMethod::ReadBytes(uint8_t *data, uint32_t length)
 {
-    if (output_len == -1 && !LoadNextBlock())
-        return -1;
-    if (output_len > length)
-        return 0;
+    // The history must be able to hold all pending bytes.
+    length = std::min(length, kHistoryKeep);
+
+    // Decode as many symbols as needed for filling |data|.
+    while (!input_ended && lzw.Pending() < length)
+        input_ended = !LoadNextBlock();
 
-    int32_t len = output_len;
-    lzw.OutputToBuffer(output_len, data);
+    uint32_t len = std::min(lzw.Pending(), length);
+    if (len == 0)
+        return -1;
 
-    output_len = -1;
+    lzw.ReadOutput(data, len);
     return len;
 }
 
@@ -32,41 +32,62 @@ namespace maconv {
 namespace stuffit {
 
 
-struct CompressTreeNode {
-    uint8_t chr;
-    int parent;
+// An entry of the LZW table (the string of a symbol).
+struct CompressEntry {
+    uint64_t pos; // Position of the string in the output.
+    uint32_t len; // Length of the string.
+    int parent; // Symbol of the string without its last byte.
+    uint8_t chr; // Last byte of the string.
 };
 
 
 // LZW (Lempel-Ziv-Welch) decoder.
+// The string of a symbol is the string of the previous symbol plus one byte,
+// so it's always found in the output at the position of the previous string:
+// strings are copied from the output history instead of walking the table.
 struct CompressLzw {
 
     // Initialize the decoder.
-    void Initialize(int max_symbols,int reserved_symbols);
+    void Initialize(int max_symbols, int reserved_symbols);
 
     // Clear the decoder table.
     void ClearTable();
 
 
-    // The the first bytes corresponding to symbol in the LZW tree.
-    uint8_t FindFirstByte(int symbol);
-
-    // Read the next symbol.
+    // Decode the next symbol (its string is added to the output history).
     void NextSymbol(int symbol);
 
+    // Number of decoded bytes not read yet.
+    uint32_t Pending() const { return history_end - history_read; }
 
-    // Calculate the number of bytes needed to write the output.
-    int CalcOutputLength();
-
-    // Write the ouput data to a buffer.
-    void OutputToBuffer(int len, uint8_t *buffer);
+    // Read |len| decoded bytes.
+    void ReadOutput(uint8_t *data, uint32_t len);
 
 
     int num_symbols, max_symbols, reserved_symbols;
-    int prev_symbol;
     int symbol_size;
 
-    std::unique_ptr<CompressTreeNode[]> nodes;
+    int prev_symbol; // Previous symbol (-1 after a clear).
+    uint64_t prev_pos; // Position of the previous string in the output.
+    uint32_t prev_len; // Length of the previous string.
+
+    std::unique_ptr<CompressEntry[]> entries;
+
+
+private:
+
+    // Write the string of a symbol at |out| (return its length).
+    uint32_t WriteString(int symbol, uint8_t *out);
+
+    // Discard old output (the most recent output is kept).
+    void SlideHistory();
+
+
+    std::unique_ptr<uint8_t[]> history; // Output history.
+    uint32_t history_size; // Size of |history|.
+    uint64_t history_base; // Position of |history| in the output.
+    uint32_t history_end; // End of the decoded data in |history|.
+    uint32_t history_read; // End of the data already read in |history|.
 };
 
 
@@ -80,7 +101,7 @@ struct CompressMethod : CompressionMethod {
     // Initialize the algorithm.
     void Initialize() override;
 
-    // Load the next block of data.
+    // Load and decode the next symbol.
     bool LoadNextBlock();
 
     // Read the next bytes.
@@ -91,7 +112,7 @@ struct CompressMethod : CompressionMethod {
     bool block_mode;
 
     int symbol_counter;
-    int output_len;
+    bool input_ended;
 
     utils::BitReaderLE input;
     CompressLzw lzw;
@@ -20,6 +20,9 @@ this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "stuffit/methods/rle90.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace maconv {
 namespace stuffit {
 
@@ -34,42 +37,63 @@ void Rle90Method::Initialize()
 
 
 
-// Read the next byte.
-uint8_t Rle90Method::ReadNextByte()
-{
-    // We have a byte to repeat.
-    if (count != 0)
-        return (count--, byte);
-
-    // Read the next byte from the stream.
-    uint8_t next = *(data++);
-    if (next != 0x90)
-        return (byte = next, byte);
-
-    // The previous byte need to be repeated (if not 0x0).
-    next = *(data++);
-    if (next == 0x0)
-        return (byte = next, byte);
-
-    count = next - 2;
-    return next;
-}
-
-
-
 // Read the next bytes.
+// Literal bytes are copied up to the next 0x90 marker and runs are expanded
+// at once ("0x90 n" repeats the previous byte n-1 times, "0x90 0" is 0x90).
 int32_t Rle90Method::ReadBytes(uint8_t *buffer, uint32_t length)
 {
     if (data == end && count == 0)
         return -1;
 
-    uint8_t *start = buffer;
-    uint8_t *end_capacity = buffer + length;
-
-    while ((data != end || count != 0) && buffer != end_capacity)
-        *(buffer++) = ReadNextByte();
-
-    return buffer - start;
+    uint8_t *out = buffer;
+    uint8_t *out_end = buffer + length;
+
+    while (out != out_end) {
+        // Write the bytes of the current run.
+        if (count != 0) {
+            uint32_t n = std::min<uint32_t>(count, out_end - out);
+            memset(out, byte, n);
+            out += n;
+            count -= n;
+            continue;
+        }
+
+        if (data == end)
+            break;
+
+        // Copy literal bytes until the next marker.
+        size_t avail = std::min<size_t>(end - data, out_end - out);
+        auto marker = static_cast<uint8_t *>(memchr(data, 0x90, avail));
+        size_t literal = (marker ? marker : data + avail) - data;
+
+        if (literal != 0) {
+            memcpy(out, data, literal);
+            out += literal;
+            data += literal;
+            byte = out[-1];
+        }
+
+        if (marker == nullptr)
+            continue;
+
+        // A marker without its count (truncated data): stop here.
+        if (end - data < 2) {
+            data = end;
+            break;
+        }
+
+        uint8_t next = data[1];
+        data += 2;
+
+        if (next == 0x0)
+            *(out++) = byte = 0x90;
+        else
+            count = next - 1;
+    }
+
+    if (out == buffer && data == end && count == 0)
+        return -1;
+    return out - buffer;
 }
 
 
@@ -32,15 +32,12 @@ struct Rle90Method : CompressionMethod {
     // Initialize the algorithm.
     void Initialize() override;
 
-    // Read the next byte.
-    uint8_t ReadNextByte();
-
     // Read the next bytes.
     int32_t ReadBytes(uint8_t *data, uint32_t length) override;
 
 
-    uint32_t count; // Number of bytes to repeat.
-    uint8_t byte; // Byte to repeat.
+    uint32_t count; // Number of bytes to repeat (not written yet).
+    uint8_t byte; // Byte to repeat (last byte written).
 };
 
 
@@ -21,12 +21,22 @@ this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "stuffit/stuffit.h"
 #include "stuffit/methods.h"
+#include "stuffit/utils/crc.h"
 #include "formats/formats.h"
+#include "formats/listing.h"
+#include "formats/entry_filter.h"
 #include "commands.h"
 
+#include <make_unique.hpp>
 #include <path.hpp>
 #include <cstdarg>
 #include <algorithm>
+#include <atomic>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
 
 namespace maconv {
 namespace stuffit {
@@ -37,6 +47,7 @@ namespace stuffit {
 static void WarnForkError(StuffitEntry &ent, bool is_res, const char *msg, ...)
 {
     va_list args;
+    flockfile(stderr);
     fprintf(stderr, "\033[1m\033[33mWARNING: ");
     fprintf(stderr, is_res ? "ressource fork " : "data fork ");
     fprintf(stderr, "of '%s' couldn't be extracted (", ent.name.c_str());
@@ -46,77 +57,244 @@ static void WarnForkError(StuffitEntry &ent, bool is_res, const char *msg, ...)
     va_end(args);
 
     fprintf(stderr, ")\033[0m\n");
+    funlockfile(stderr);
 }
 
 
 
-// Extract a single fork.
-static void ExtractFork(StuffitEntry &ent, bool is_res, fs::File &file,
-    uint8_t *data)
+// Warn the user that a fork has been extracted with an invalid CRC.
+static void WarnForkCRC(StuffitEntry &ent, bool is_res)
 {
-    const StuffitCompInfo &info = is_res ? ent.res : ent.data;
+    flockfile(stderr);
+    fprintf(stderr, "\033[1m\033[33mWARNING: ");
+    fprintf(stderr, is_res ? "ressource fork " : "data fork ");
+    fprintf(stderr, "of '%s' has an invalid CRC (it may be corrupted)", ent.name.c_str());
+    fprintf(stderr, "\033[0m\n");
+    funlockfile(stderr);
+}
+
+
+
+// Warn the user that a fork has been truncated (and filled with zeros).
+static void WarnForkTruncated(StuffitEntry &ent, bool is_res, uint32_t written,
+    uint32_t size)
+{
+    flockfile(stderr);
+    fprintf(stderr, "\033[1m\033[33mWARNING: ");
+    fprintf(stderr, is_res ? "ressource fork " : "data fork ");
+    fprintf(stderr, "of '%s' has been truncated (%u of %u bytes extracted, ", ent.name.c_str(), written, size);
+    fprintf(stderr, "the rest is filled with zeros)\033[0m\n");
+    funlockfile(stderr);
+}
+
+
 
-    // Select the compression handler and extract the fork.
+// Get the path of an entry, without the '\r' that some names end with.
+static std::string GetCleanPath(const StuffitEntry &ent)
+{
+    std::string path = ent.FullName();
+    path.erase(std::remove(path.begin(), path.end(), '\r'), path.end());
+    return path;
+}
+
+
+
+// Fork sink that writes uncompressed data to a file writer.
+struct WriterSink : ForkSink {
+
+    WriterSink(fs::FileWriter &w, uint32_t s) : writer{w}, size{s} {}
+
+    // Write a chunk of data (never write more than |size| bytes).
+    uint32_t Write(uint8_t *data, uint32_t length) override
+    {
+        length = std::min(length, size - written);
+        writer.Write(data, length);
+        written += length;
+        return length;
+    }
+
+    fs::FileWriter &writer; // Destination writer.
+    uint32_t size; // Size of the fork.
+    uint32_t written = 0; // Number of bytes written.
+};
+
+
+// Fork sink that stores uncompressed data in memory.
+struct MemorySink : ForkSink {
+
+    // Write a chunk of data.
+    uint32_t Write(uint8_t *data, uint32_t length) override
+    {
+        buffer.insert(buffer.end(), data, data + length);
+        return length;
+    }
+
+    std::vector<uint8_t> buffer; // Uncompressed data.
+};
+
+
+// Fork sink that computes the CRC-16 of the data kept by another sink.
+struct CRCSink : ForkSink {
+
+    CRCSink(ForkSink &s) : sink{s} {}
+
+    // Write a chunk of data (only the bytes kept by |sink| are in the CRC).
+    uint32_t Write(uint8_t *data, uint32_t length) override
+    {
+        length = sink.Write(data, length);
+        crc = CalcCRC16(crc, data, length);
+        return length;
+    }
+
+    ForkSink &sink; // Destination sink.
+    uint16_t crc = 0; // CRC of the data (so far).
+};
+
+
+
+// Extract a single fork into a sink (return false on error).
+static bool ExtractFork(StuffitEntry &ent, bool is_res, uint8_t *data,
+    ForkSink &sink)
+{
+    const StuffitCompInfo &info = is_res ? ent.res : ent.data;
     auto ptr = GetCompressionMethod(info.method);
-    if (!ptr)
-        return (void)WarnForkError(ent, is_res, "compression method %u not supported", info.method);
 
     // Try extracting the fork.
     LogDebug("  Extracting %s fork using algo %d", (is_res ? "ressource" : "data"), info.method);
+    CRCSink crc_sink {sink};
     try {
-        ptr->Extract(info, data, file.mem_pool);
+        ptr->Extract(info, data, crc_sink);
     } catch (ExtractException &e) {
-        return (void)WarnForkError(ent, is_res, e.what());
+        WarnForkError(ent, is_res, e.what());
+        return false;
+    }
+
+    // The data is kept even if it seems corrupted.
+    if (!ptr->CheckCRC(info, crc_sink.crc))
+        WarnForkCRC(ent, is_res);
+
+    return true;
+}
+
+
+// Stream a fork to the output file (while it is uncompressed).
+static void StreamFork(StuffitEntry &ent, bool is_res, uint8_t *data,
+    fs::FileWriter &writer)
+{
+    uint32_t size = is_res ? ent.res.size : ent.data.size;
+    WriterSink sink {writer, size};
+    ExtractFork(ent, is_res, data, sink);
+
+    // The fork size has already been given to the converter: keep it.
+    if (sink.written < size) {
+        WarnForkTruncated(ent, is_res, sink.written, size);
+        writer.Fill(0x0, size - sink.written);
+    }
+}
+
+
+// Extract a fork in memory (when its uncompressed size is unknown).
+static void ExtractForkInMemory(StuffitEntry &ent, bool is_res, fs::File &file,
+    uint8_t *data)
+{
+    MemorySink sink;
+    if (!ExtractFork(ent, is_res, data, sink))
+        return;
+
+    uint32_t size = sink.buffer.size();
+    auto buffer = std::make_unique<uint8_t[]>(size);
+    std::copy(sink.buffer.begin(), sink.buffer.end(), buffer.get());
+
+    // Fill file information.
+    if (is_res) {
+        file.res = buffer.get();
+        file.res_size = size;
+    } else {
+        file.data = buffer.get();
+        file.data_size = size;
     }
 
+    // Save the buffer to the memory pool.
+    file.mem_pool.push_back(std::move(buffer));
+}
+
+
+// Prepare a fork for extraction: the fork is streamed to the output file
+// when the file is written (or extracted now if its size is unknown).
+static void PrepareFork(StuffitEntry &ent, bool is_res, fs::File &file,
+    uint8_t *data)
+{
+    const StuffitCompInfo &info = is_res ? ent.res : ent.data;
+
+    // Make sure that the compression method is supported.
+    if (!GetCompressionMethod(info.method))
+        return (void)WarnForkError(ent, is_res, "compression method %u not supported", info.method);
+
+    if (info.size == 0)
+        return ExtractForkInMemory(ent, is_res, file, data);
+
+    auto stream = [&ent, is_res, data](fs::FileWriter &writer) {
+        StreamFork(ent, is_res, data, writer);
+    };
+
     // Fill file information.
     if (is_res) {
-        file.res = ptr->uncompressed;
-        file.res_size = ptr->total_size;
+        file.res_stream = stream;
+        file.res_size = info.size;
     } else {
-        file.data_size = ptr->total_size;
-        file.data = ptr->uncompressed;
+        file.data_stream = stream;
+        file.data_size = info.size;
     }
 }
 
 
 
+// Get the path of the file extracted from an entry.
+static std::string GetOutputFilename(const StuffitEntry &ent, const std::string &output)
+{
+    std::string dest_folder = ent.folder.empty() ? output : output + "/" + ent.folder;
+    std::string filename = dest_folder + "/" + GetFilenameFor(ent.name, prefered_conv);
+    filename.erase(std::remove(filename.begin(), filename.end(), '\r'), filename.end());
+    return filename;
+}
+
+
+
 // Extract a file.
 static void ExtractFile(fs::FileReader &reader, StuffitEntry &ent,
-    const std::string &dest_folder)
+    const std::string &output)
 {
     // Copy extracted data to file object.
     fs::File file;
     file.Reset();
 
     file.type = ent.type;
-    file.creator = ent.type;
-    file.flags = ent.type;
-    file.creation_date = ent.type;
-    file.modif_date = ent.type;
+    file.creator = ent.creator;
+    file.flags = ent.flags;
+    file.creation_date = ent.creation_date;
+    file.modif_date = ent.modif_date;
     file.filename = ent.name;
 
     // Log information to user.
-    std::string filename = dest_folder + "/" + GetFilenameFor(ent.name, prefered_conv);
-    filename.erase(std::remove(filename.begin(), filename.end(), '\r'), filename.end());
+    std::string filename = GetOutputFilename(ent, output);
     LogDebug("Extracting %s ...", filename.c_str());
 
-    // Uncompress forks (if not empty).
+    // Prepare forks (if not empty).
     if (ent.data.comp_size > 0)
-        ExtractFork(ent, false, file, reader.data);
+        PrepareFork(ent, false, file, reader.data);
     if (ent.res.comp_size > 0)
-        ExtractFork(ent, true, file, reader.data);
+        PrepareFork(ent, true, file, reader.data);
 
-    // Save the file.
+    // Save the file (forks are uncompressed while they are written).
     PackLocalFile(file, filename, prefered_conv);
 }
 
 
 
 // Extract a directory.
-static void ExtractDirectory(StuffitEntry &ent, const std::string &dest_folder)
+static void ExtractDirectory(StuffitEntry &ent, const std::string &output)
 {
-    std::string dirname = dest_folder + "/" + ent.name;
+    std::string dirname = output + "/" + ent.FullName();
     Path::makedirs(dirname);
 
     // TODO: set mofitication date.
@@ -124,14 +302,144 @@ static void ExtractDirectory(StuffitEntry &ent, const std::string &dest_folder)
 
 
 
-// Extract a Stuffit entry.
-void ExtractStuffitEntry(fs::FileReader &reader, StuffitEntry &ent,
-    const std::string &dest_folder)
+// Extract files (using |num_jobs| threads).
+static void ExtractFiles(fs::FileReader &reader, const std::vector<StuffitEntry *> &files,
+    const std::string &output)
 {
-    if (ent.etype == StuffitEntryType::File)
-        ExtractFile(reader, ent, dest_folder);
-    else if (ent.etype == StuffitEntryType::Folder)
-        ExtractDirectory(ent, dest_folder);
+    // Entries extracted to the same path go in the same group, in archive
+    // order, so that they are never written at the same time and the last
+    // one still wins.
+    using FileGroup = std::vector<StuffitEntry *>;
+    std::vector<FileGroup> groups;
+    std::map<std::string, size_t> group_of;
+
+    for (StuffitEntry *ent : files) {
+        auto it = group_of.emplace(GetOutputFilename(*ent, output), groups.size());
+        if (it.second)
+            groups.emplace_back();
+        groups[it.first->second].push_back(ent);
+    }
+
+    // Extract the biggest groups first (for balancing the threads).
+    if (num_jobs > 1) {
+        auto size_of = [](const FileGroup &group) {
+            uint64_t size = 0;
+            for (StuffitEntry *ent : group)
+                size += (uint64_t)ent->data.comp_size + ent->res.comp_size;
+            return size;
+        };
+
+        std::stable_sort(groups.begin(), groups.end(), [&](const FileGroup &a, const FileGroup &b) {
+            return size_of(a) > size_of(b);
+        });
+    }
+
+    // Each thread takes the next group to extract. The first error stops all
+    // threads and is rethrown once they are joined.
+    std::atomic<size_t> next {0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto worker = [&]() {
+        try {
+            for (size_t i; (i = next++) < groups.size();) {
+                for (StuffitEntry *ent : groups[i])
+                    ExtractFile(reader, *ent, output);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock {error_mutex};
+            if (!error)
+                error = std::current_exception();
+            next = groups.size();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    size_t num_threads = std::min<size_t>(std::max(num_jobs, 1), groups.size());
+
+    for (size_t i = 1; i < num_threads; i++)
+        threads.emplace_back(worker);
+
+    worker();
+    for (auto &thread : threads)
+        thread.join();
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+
+// Extract all entries of a Stuffit archive.
+// Folders are created first, then files are extracted by |num_jobs| threads.
+void ExtractStuffitEntries(fs::FileReader &reader, StuffitEntries &entries,
+    const std::string &output)
+{
+    std::vector<StuffitEntry *> files;
+
+    // Without a filter, extract all folders (even empty ones).
+    if (entry_filter.IsEmpty()) {
+        for (auto &ent : entries) {
+            if (ent.etype == StuffitEntryType::Folder)
+                ExtractDirectory(ent, output);
+            else if (ent.etype == StuffitEntryType::File)
+                files.push_back(&ent);
+        }
+
+        return ExtractFiles(reader, files, output);
+    }
+
+    // Else, extract only the selected files and their parent folders.
+    std::set<std::string> folders;
+
+    for (auto &ent : entries) {
+        if (ent.etype != StuffitEntryType::File)
+            continue;
+        if (!entry_filter.Match(GetCleanPath(ent), ent.type, ent.creator))
+            continue;
+
+        files.push_back(&ent);
+        if (folders.insert(ent.folder).second && !ent.folder.empty())
+            Path::makedirs(output + "/" + ent.folder);
+    }
+
+    ExtractFiles(reader, files, output);
+}
+
+
+
+// Get listing information about a fork.
+static ListFork GetListFork(const StuffitCompInfo &info)
+{
+    ListFork fork {info.size, info.comp_size, ""};
+    if (info.comp_size > 0)
+        fork.method = GetCompressionMethodName(info.method);
+    return fork;
+}
+
+
+// List all entries of a Stuffit archive (nothing is uncompressed).
+void ListStuffitEntries(const StuffitEntries &entries)
+{
+    PrintListHeader();
+
+    for (auto &ent : entries) {
+        ListEntry lent;
+        lent.path = GetCleanPath(ent);
+        lent.is_dir = (ent.etype == StuffitEntryType::Folder);
+
+        lent.type = ent.type;
+        lent.creator = ent.creator;
+        lent.flags = ent.flags;
+        lent.creation_date = ent.creation_date;
+        lent.modif_date = ent.modif_date;
+
+        if (!lent.is_dir) {
+            lent.data = GetListFork(ent.data);
+            lent.res = GetListFork(ent.res);
+        }
+
+        PrintListEntry(lent);
+    }
 }
 
 
@@ -26,6 +26,7 @@ this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "fs/file_writer.h"
 
 #include <string>
+#include <vector>
 
 namespace maconv {
 namespace stuffit {
@@ -43,6 +44,7 @@ struct StuffitCompInfo {
     uint32_t offset; // Compressed data offset in the archive.
     uint32_t size; // Fork size (uncompressed).
     uint32_t comp_size; // Fork size (compressed).
+    uint16_t crc; // CRC-16 of the fork (uncompressed).
 };
 
 
@@ -50,6 +52,7 @@ struct StuffitCompInfo {
 struct StuffitEntry {
     StuffitEntryType etype; // Entry type (folder, file, end folder).
     std::string name; // Name of the file/directory.
+    std::string folder; // Parent folder (relative to the archive root).
 
     uint32_t entity_off; // Entity offset.
     uint32_t parent_off; // Parent offset.
@@ -66,22 +69,36 @@ struct StuffitEntry {
 
     StuffitCompInfo data; // Info about data fork.
     StuffitCompInfo res; // Info about res fork.
+
+
+    // Get the path of the entry (relative to the archive root).
+    std::string FullName() const { return folder.empty() ? name : folder + "/" + name; }
 };
 
 
+// All entries of a Stuffit archive (in archive order).
+using StuffitEntries = std::vector<StuffitEntry>;
+
+
 
 // Stuffit (v1) functions.
 bool IsFileStuffit1(fs::FileReader &reader);
 void ExtractStuffit1(fs::FileReader &reader, const std::string &output);
+void ListStuffit1(fs::FileReader &reader);
 
 // Stuffit (v5) functions.
 bool IsFileStuffit5(fs::FileReader &reader);
 void ExtractStuffit5(fs::FileReader &reader, const std::string &output);
+void ListStuffit5(fs::FileReader &reader);
+
 
+// Extract all entries of a Stuffit archive.
+// Folders are created first, then files are extracted by |num_jobs| threads.
+void ExtractStuffitEntries(fs::FileReader &reader, StuffitEntries &entries,
+    const std::string &output);
 
-// Extract a Stuffit entry.
-void ExtractStuffitEntry(fs::FileReader &reader, StuffitEntry &ent,
-    const std::string &dest_folder);
+// List all entries of a Stuffit archive (nothing is uncompressed).
+void ListStuffitEntries(const StuffitEntries &entries);
 
 
 } // namespace stuffit
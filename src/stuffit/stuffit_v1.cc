@@ -20,6 +20,7 @@ this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #include "stuffit/stuffit.h"
+#include "commands.h"
 
 #include <limits>
 
@@ -103,12 +104,14 @@ static void ReadFileHeader(fs::FileReader &reader, StuffitEntry &ent)
     if (ent.etype == StuffitEntryType::Folder)
         return (void)reader.Skip(28);
 
-    // Read data and res sizes and skip CRC-16.
+    // Read data and res sizes and CRC-16.
     ent.res.size = reader.ReadWordBE();
     ent.data.size = reader.ReadWordBE();
     ent.res.comp_size = reader.ReadWordBE();
     ent.data.comp_size = reader.ReadWordBE();
-    reader.Skip(12);
+    ent.res.crc = reader.ReadHalfBE();
+    ent.data.crc = reader.ReadHalfBE();
+    reader.Skip(8);
 
     // Set ressource and data offsets.
     ent.res.offset = reader.Tell();
@@ -120,30 +123,53 @@ static void ReadFileHeader(fs::FileReader &reader, StuffitEntry &ent)
 
 
 
-// Extract a Stuffit (v1) directory.
-static void ExtractDirectory(fs::FileReader &reader, const std::string &dest_dir,
-    uint32_t total_size)
+// Read entries of a Stuffit (v1) directory.
+static void ReadDirectory(fs::FileReader &reader, StuffitEntries &entries,
+    const std::string &folder, uint32_t total_size)
 {
     StuffitEntry ent;
 
     while (reader.Tell() < total_size) {
         ReadFileHeader(reader, ent);
-        ExtractStuffitEntry(reader, ent, dest_dir);
+        if (reader.HasFailed())
+            StopOnError("Stuffit archive is truncated");
 
         if (ent.etype == StuffitEntryType::EndFolder)
             break;
+
+        ent.folder = folder;
+        entries.push_back(ent);
+
         if (ent.etype == StuffitEntryType::Folder)
-            ExtractDirectory(reader, dest_dir + "/" + ent.name, total_size);
+            ReadDirectory(reader, entries, ent.FullName(), total_size);
     }
 }
 
 
+// Read all entries of a Stuffit (v1) archive.
+static void ReadEntries(fs::FileReader &reader, StuffitEntries &entries)
+{
+    uint32_t total_size = ReadHeader(reader);
+    ReadDirectory(reader, entries, "", total_size);
+}
+
+
 
 // Extract a Stuffit (v1) archive.
 void ExtractStuffit1(fs::FileReader &reader, const std::string &output)
 {
-    uint32_t total_size = ReadHeader(reader);
-    ExtractDirectory(reader, output, total_size);
+    StuffitEntries entries;
+    ReadEntries(reader, entries);
+    ExtractStuffitEntries(reader, entries, output);
+}
+
+
+// List the content of a Stuffit (v1) archive.
+void ListStuffit1(fs::FileReader &reader)
+{
+    StuffitEntries entries;
+    ReadEntries(reader, entries);
+    ListStuffitEntries(entries);
 }
 
 
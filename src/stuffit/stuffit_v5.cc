@@ -107,7 +107,8 @@ static void ReadFileHeader(fs::FileReader &reader, StuffitEntry &ent)
     reader.Skip(2);  // Skip header CRC.
     ent.data.size = reader.ReadWordBE();
     ent.data.comp_size = reader.ReadWordBE();
-    reader.Skip(4);  // Skip data CRC.
+    ent.data.crc = reader.ReadHalfBE();
+    reader.Skip(2);
 
 
     // The entry is a folder: read the number of files.
@@ -154,7 +155,8 @@ static void ReadFileHeader(fs::FileReader &reader, StuffitEntry &ent)
     if (has_res) {
         ent.res.size = reader.ReadWordBE();
         ent.res.comp_size = reader.ReadWordBE();
-        reader.Skip(4);  // Skip ressource CRC.
+        ent.res.crc = reader.ReadHalfBE();
+        reader.Skip(2);
         ent.res.method = reader.ReadByte();
         reader.Skip(1);  // Skip password length (as archive is not encrypted).
     } else {
@@ -177,32 +179,52 @@ static void ReadFileHeader(fs::FileReader &reader, StuffitEntry &ent)
 
 
 
-// Extract a directoty.
-void ExtractStuffit5(fs::FileReader &reader, const std::string &output)
+// Read all entries of a Stuffit (v5) archive.
+static void ReadEntries(fs::FileReader &reader, StuffitEntries &entries)
 {
-    uint16_t num_files = ReadHeader(reader);
+    uint32_t num_files = ReadHeader(reader);
     std::unordered_map<uint32_t, std::string> folders;
 
     StuffitEntry ent;
-    std::string dest_folder;
 
-    for (uint16_t i = 0; i < num_files; i++) {
+    for (uint32_t i = 0; i < num_files; i++) {
         ReadFileHeader(reader, ent);
+        if (reader.HasFailed())
+            StopOnError("Stuffit archive is truncated");
 
         // Get the parent folder of the file.
         auto folder = folders.find(ent.parent_off);
-        dest_folder = (folder != folders.end()) ? folder->second : output;
-
-        ExtractStuffitEntry(reader, ent, dest_folder);
+        ent.folder = (folder != folders.end()) ? folder->second : "";
         num_files += ent.num_files;
 
         // Add this directory to folders map.
         if (ent.etype == StuffitEntryType::Folder)
-            folders[ent.entity_off] = dest_folder + "/" + ent.name;
+            folders[ent.entity_off] = ent.FullName();
+
+        entries.push_back(ent);
     }
 }
 
 
 
+// Extract a Stuffit (v5) archive.
+void ExtractStuffit5(fs::FileReader &reader, const std::string &output)
+{
+    StuffitEntries entries;
+    ReadEntries(reader, entries);
+    ExtractStuffitEntries(reader, entries, output);
+}
+
+
+// List the content of a Stuffit (v5) archive.
+void ListStuffit5(fs::FileReader &reader)
+{
+    StuffitEntries entries;
+    ReadEntries(reader, entries);
+    ListStuffitEntries(entries);
+}
+
+
+
 } // namespace maconv
 } // namespace stuffit
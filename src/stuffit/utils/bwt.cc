@@ -29,6 +29,7 @@ namespace stuffit {
 
 
 // Calculate inverse of BWT.
+// Each entry packs the next index (high 24 bits) with its byte (low 8 bits).
 void CalculateInverseBWT(uint32_t *transform, uint8_t *block, int block_len)
 {
     int counts[256] = {0};
@@ -44,12 +45,24 @@ void CalculateInverseBWT(uint32_t *transform, uint8_t *block, int block_len)
     }
 
     for (int i = 0; i < block_len; i++) {
-        transform[cumulative_counts[block[i]] + counts[block[i]]] = i;
+        transform[cumulative_counts[block[i]] + counts[block[i]]] = (i << 8) | block[i];
         counts[block[i]]++;
     }
 }
 
 
+// Undo the BWT of |block| in place, starting at |index|.
+void ApplyInverseBWT(const uint32_t *transform, uint8_t *block, int block_len,
+    uint32_t index)
+{
+    for (int i = 0; i < block_len; i++) {
+        uint32_t entry = transform[index];
+        block[i] = entry & 0xFF;
+        index = entry >> 8;
+    }
+}
+
+
 
 // Reset the decoder.
 void MtfDecoder::ResetDecoder()
@@ -59,18 +72,6 @@ void MtfDecoder::ResetDecoder()
 }
 
 
-// Decode the next symbol.
-int MtfDecoder::Decode(int symbol)
-{
-    int res = table[symbol];
-    for (int i = symbol; i > 0; i--)
-        table[i] = table[i-1];
-    
-    table[0] = res;
-    return res;
-}
-
-
 
 } // namespace stuffit
 } // namespace maconv
@@ -24,6 +24,11 @@ this program.  If not, see <https://www.gnu.org/licenses/>.
 #pragma once
 
 #include <inttypes.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace maconv {
 namespace stuffit {
@@ -36,16 +41,57 @@ struct MtfDecoder {
     void ResetDecoder();
 
     // Decode the next symbol.
-    int Decode(int symbol);
+    uint8_t Decode(int symbol);
 
-    int table[256];
+    alignas(16) uint8_t table[256];
 };
 
 
 
+// Decode the next symbol.
+// Most symbols are in the first 16 entries: move them with one SSE2 register.
+inline uint8_t MtfDecoder::Decode(int symbol)
+{
+    uint8_t res = table[symbol];
+
+    if (symbol == 0)
+        return res;
+
+    if (symbol == 1) {
+        table[1] = table[0];
+    } else if (symbol < 16) {
+#ifdef __SSE2__
+        const __m128i indexes = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9,
+            10, 11, 12, 13, 14, 15);
+        __m128i keep = _mm_cmpgt_epi8(indexes, _mm_set1_epi8(symbol));
+        __m128i entries = _mm_load_si128((__m128i *)table);
+        __m128i shifted = _mm_slli_si128(entries, 1);
+
+        entries = _mm_or_si128(_mm_and_si128(keep, entries),
+            _mm_andnot_si128(keep, shifted));
+        _mm_store_si128((__m128i *)table, entries);
+#else
+        for (int i = symbol; i > 0; i--)
+            table[i] = table[i-1];
+#endif
+    } else {
+        memmove(&table[1], &table[0], symbol);
+    }
+
+    table[0] = res;
+    return res;
+}
+
+
+
 // Calculate inverse of BWT.
+// Each entry packs the next index (high 24 bits) with its byte (low 8 bits).
 void CalculateInverseBWT(uint32_t *transform, uint8_t *block, int block_len);
 
+// Undo the BWT of |block| in place, starting at |index|.
+void ApplyInverseBWT(const uint32_t *transform, uint8_t *block, int block_len,
+    uint32_t index);
+
 
 } // namespace stuffit
 } // namespace maconv
@@ -24,17 +24,18 @@ this program.  If not, see <https://www.gnu.org/licenses/>.
 #pragma once
 
 #include <inttypes.h>
+#include <stddef.h>
 
 namespace maconv {
 namespace stuffit {
 
 
-// CRC tables.
-extern const uint32_t CRCTable_edb88320[256];
+// Update a CRC-32 (polynomial EDB88320) with |length| bytes of |data|.
+// The CRC isn't inverted before or after (the caller does it).
+uint32_t CalcCRC32(uint32_t crc, const uint8_t *data, size_t length);
 
-
-// Calculate CRC for the next byte.
-uint32_t CalcCRC(uint32_t prevcrc, uint8_t byte, const uint32_t *table);
+// Update a CRC-16 (polynomial A001) with |length| bytes of |data|.
+uint16_t CalcCRC16(uint16_t crc, const uint8_t *data, size_t length);
 
 
 } // namespace stuffit
@@ -24,7 +24,7 @@ this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "stuffit/utils/huffman.h"
 #include "stuffit/methods.h"
 
-#include <make_unique.hpp>
+#include <algorithm>
 #include <limits>
 
 namespace maconv {
@@ -51,20 +51,11 @@ static uint32_t ReverseN(uint32_t val, int length)
 
 
 
-// Copy an Huffman decoder.
-HuffmanDecoder &HuffmanDecoder::operator=(const HuffmanDecoder &other)
-{
-    tree = other.tree;
-    num_entries = other.num_entries;
-    min_length = other.min_length;
-    max_length = other.max_length;
-    return *this;
-}
-
-
 // Initialize the decoder.
 void HuffmanDecoder::Initialize()
 {
+    tree.clear();
+    codes.clear();
     NewNode();
     num_entries = 1;
 
@@ -73,25 +64,55 @@ void HuffmanDecoder::Initialize()
 }
 
 
-// Initialize the decoder (with some lengths).
+// Initialize the decoder with a canonical code (no tree is built).
+// Codes are given by increasing length, then by increasing symbol.
 void HuffmanDecoder::Initialize(const int *lengths, int numsymbols, int maxcodelength,
     bool zeros)
 {
-    Initialize();
-    int code = 0, symbolsleft = numsymbols;
+    int count[33] = {0}, offset[33];
 
-    for (int length = 1; length <= maxcodelength; length++) {
-        for (int i = 0; i < numsymbols; i++) {
-            if (lengths[i] != length) continue;
+    tree.clear();
+    num_entries = 0;
+    min_length = std::numeric_limits<int>::max();
+    max_length = std::numeric_limits<int>::min();
 
-            AddValue(i, zeros ? code : ~code, length);
-            code++;
+    // Sort the symbols by length (counting sort).
+    maxcodelength = std::min(maxcodelength, 32);
+    for (int i = 0; i < numsymbols; i++) {
+        if (lengths[i] > 0 && lengths[i] <= maxcodelength)
+            count[lengths[i]]++;
+    }
 
-            if (--symbolsleft == 0) return; // Early exit if all codes have been handled.
-        }
+    offset[1] = 0;
+    for (int length = 1; length < 32; length++)
+        offset[length + 1] = offset[length] + count[length];
 
-        code <<= 1;
+    codes.resize(offset[32] + count[32]);
+    for (int i = 0; i < numsymbols; i++) {
+        if (lengths[i] > 0 && lengths[i] <= maxcodelength)
+            codes[offset[lengths[i]]++] = {i, 0, lengths[i]};
     }
+
+    // Give the codes, in increasing order.
+    uint64_t code = 0;
+    int length = 0;
+
+    for (auto &entry : codes) {
+        code <<= (entry.length - length);
+        length = entry.length;
+
+        if (code >> length)
+            throw ExtractException("Huffman: prefix already exists");
+
+        uint32_t mask = (1ull << length) - 1;
+        entry.code = (zeros ? code : ~code) & mask;
+        code++;
+
+        max_length = std::max(max_length, length);
+        min_length = std::min(min_length, length);
+    }
+
+    num_entries = codes.size();
 }
 
 
@@ -166,25 +187,66 @@ void HuffmanDecoder::AddValueLF(int value, uint32_t code, int length, int repeat
 
 
 // Get the next symbol from a bit reader.
-int HuffmanDecoder::NextSymbol(utils::BitReader &input)
+template <utils::Endian E>
+int HuffmanDecoder::NextSymbol(utils::BitReader<E> &input) const
+{
+    if (table.empty())
+        throw ExtractException("Huffman: search table not built");
+
+    return EntrySymbol(input, &table[input.ReadWord(table_size, false)]);
+}
+
+
+// Get the next one or two symbols from a bit reader.
+// Return the number of symbols read.
+template <utils::Endian E>
+int HuffmanDecoder::NextSymbols(utils::BitReader<E> &input, int *symbols) const
 {
-    if (!table)
+    if (table.empty())
         throw ExtractException("Huffman: search table not built");
 
-    int bits = input.ReadWord(table_size, false);
-    int length = table[bits].length;
-    int value = table[bits].value;
+    const HuffmanTableEntry *entry = &table[input.ReadWord(table_size, false)];
 
-    if (length < 0)
-        throw ExtractException("Huffman: invalid prefix code when getting next symbol [length]");
+    // Symbols and pairs are read the same way (without branching on the kind).
+    // Don't read the second symbol if the data ends after the first one.
+    if (entry->kind <= HuffmanEntryKind::Pair && !input.HasEnded(entry->extra)) {
+        input.SkipBits(entry->extra);
+        symbols[0] = entry->value;
+        symbols[1] = entry->value2;
+        return 1 + (entry->kind == HuffmanEntryKind::Pair);
+    }
+
+    symbols[0] = EntrySymbol(input, entry);
+    return 1;
+}
 
-    if (length <= table_size) {
-        input.SkipBits(length);
-        return value;
+
+// Get the symbol of an entry of the root table (and skip its bits).
+template <utils::Endian E>
+int HuffmanDecoder::EntrySymbol(utils::BitReader<E> &input,
+    const HuffmanTableEntry *entry) const
+{
+    if (entry->kind <= HuffmanEntryKind::Pair) {
+        input.SkipBits(entry->length);
+        return entry->value;
+    }
+
+    while (entry->kind == HuffmanEntryKind::SubTable) {
+        input.SkipBits(entry->length);
+        entry = &table[entry->value + input.ReadWord(entry->extra, false)];
+
+        if (entry->kind == HuffmanEntryKind::Symbol) {
+            input.SkipBits(entry->length);
+            return entry->value;
+        }
     }
 
-    input.SkipBits(table_size);
-    int node = value;
+    if (entry->kind == HuffmanEntryKind::Invalid)
+        throw ExtractException("Huffman: invalid prefix code when getting next symbol [length]");
+
+    input.SkipBits(entry->length);
+
+    int node = entry->value;
 
     for (int bit; !IsLeafNode(node); node = Branch(node, bit)) {
         bit = input.ReadBit();
@@ -196,77 +258,171 @@ int HuffmanDecoder::NextSymbol(utils::BitReader &input)
 }
 
 
+// Instantiate the search functions for both bit readers.
+template int HuffmanDecoder::NextSymbol(utils::BitReaderBE &input) const;
+template int HuffmanDecoder::NextSymbol(utils::BitReaderLE &input) const;
+template int HuffmanDecoder::NextSymbols(utils::BitReaderBE &input, int *symbols) const;
+template int HuffmanDecoder::NextSymbols(utils::BitReaderLE &input, int *symbols) const;
+
+
+
+// Maximal index size of the root table and of the sub-tables.
+constexpr int kMaxTableSize = 10;
+
+// Maximal index size of a root table with pairs.
+constexpr int kMaxPairTableSize = 12;
 
-// Make search table (Little Endian).
-void HuffmanDecoder::MakeTableRecursLE(int node, HuffmanTableEntry *table,
-    int depth)
+
+// Get the depth of a sub-tree (at most |limit|).
+int HuffmanDecoder::SubTreeDepth(int node, int limit) const
 {
-    int curr_table_size = (1 << (table_size - depth));
-    int curr_stride = (1 << depth);
+    if (limit == 0 || IsInvalidNode(node) || IsLeafNode(node))
+        return 0;
+
+    return 1 + std::max(SubTreeDepth(LeftBranch(node), limit - 1),
+        SubTreeDepth(RightBranch(node), limit - 1));
+}
+
+
+// Fill the entries of the table at |pos| (index size of |bits|) for the
+// sub-tree |node|, found at |depth| with the bits of |prefix|.
+void HuffmanDecoder::FillTable(int node, uint32_t pos, int bits, int depth,
+    uint32_t prefix, bool is_LE, bool sub_table)
+{
+    HuffmanTableEntry entry = {0, HuffmanEntryKind::Invalid, 0, 0, 0};
+    entry.length = depth;
 
     if (IsInvalidNode(node)) {
-        for (int i = 0; i < curr_table_size; i++)
-            table[i * curr_stride].length = -1;
+        // Keep the invalid entry.
     }
     else if (IsLeafNode(node)) {
-        for (int i = 0; i < curr_table_size; i++) {
-            table[i * curr_stride].length = depth;
-            table[i * curr_stride].value = LeafValue(node);
-        }
+        entry.kind = HuffmanEntryKind::Symbol;
+        entry.value = LeafValue(node);
+        entry.extra = depth;
+    }
+    else if (depth < bits) {
+        int next = is_LE ? 1 << depth : 1;
+        prefix = is_LE ? prefix : prefix << 1;
+        FillTable(LeftBranch(node), pos, bits, depth + 1, prefix, is_LE, sub_table);
+        FillTable(RightBranch(node), pos, bits, depth + 1, prefix | next, is_LE, sub_table);
+        return;
+    }
+    else if (sub_table) {
+        entry.kind = HuffmanEntryKind::Node; // Codes longer than both tables.
+        entry.value = node;
     }
     else {
-        if (depth == table_size) {
-            table[0].length = table_size + 1;
-            table[0].value = node;
-        } else {
-            MakeTableRecursLE(LeftBranch(node), table, depth + 1);
-            MakeTableRecursLE(RightBranch(node), table + curr_stride, depth + 1);
-        }
+        // Sub-tables are as large as the longest code of their sub-tree.
+        int limit = std::min(std::max(max_length - bits, 1), kMaxTableSize);
+        int sub_bits = SubTreeDepth(node, limit);
+        entry.kind = HuffmanEntryKind::SubTable;
+        entry.extra = sub_bits;
+        entry.value = table.size();
+
+        table.resize(table.size() + (1 << sub_bits), {0, HuffmanEntryKind::Invalid, 0, 0, 0});
+        FillTable(node, entry.value, sub_bits, 0, 0, is_LE, true);
     }
+
+    // Fill all the indexes starting with |prefix|.
+    int free_bits = bits - depth;
+    for (uint32_t i = 0; i < (1u << free_bits); i++)
+        table[pos + (is_LE ? prefix | (i << depth) : (prefix << free_bits) | i)] = entry;
 }
 
 
-// Make search table (Big Endian).
-void HuffmanDecoder::MakeTableRecursBE(int node, HuffmanTableEntry *table,
-    int depth)
+// Fill the entries of the table at |pos| (index size of |bits|) for the
+// canonical |codes| (sorted), after their first |skip| bits.
+void HuffmanDecoder::FillTableCodes(const HuffmanCode *codes, int num_codes,
+    uint32_t pos, int bits, int skip, bool is_LE)
 {
-    int curr_table_size = (1 << (table_size - depth));
+    for (int i = 0; i < num_codes;) {
+        int length = codes[i].length - skip;
 
-    if (IsInvalidNode(node)) {
-        for (int i = 0; i < curr_table_size; i++)
-            table[i].length = -1;
-    }
-    else if (IsLeafNode(node)) {
-        for(int i = 0; i < curr_table_size; i++) {
-            table[i].length = depth;
-            table[i].value = LeafValue(node);
+        // The code fits in the table: fill all the indexes starting with it.
+        if (length <= bits) {
+            HuffmanTableEntry entry = {codes[i].symbol, HuffmanEntryKind::Symbol, 0, 0, 0};
+            entry.length = entry.extra = length;
+
+            uint32_t code = codes[i].code & ((1ull << length) - 1);
+            uint32_t prefix = is_LE ? ReverseN(code, length) : code << (bits - length);
+            int free_bits = bits - length;
+
+            for (uint32_t j = 0; j < (1u << free_bits); j++)
+                table[pos + (is_LE ? prefix | (j << length) : prefix | j)] = entry;
+
+            i++;
+            continue;
         }
+
+        // Longer codes with the same prefix are put in a sub-table (they
+        // follow each other, as codes are sorted).
+        uint32_t prefix = (codes[i].code >> (length - bits)) & ((1u << bits) - 1);
+        int last = i, max_length = length;
+
+        for (; last < num_codes; last++) {
+            int next_length = codes[last].length - skip;
+            if (next_length <= bits) break;
+            if (((codes[last].code >> (next_length - bits)) & ((1u << bits) - 1)) != prefix) break;
+            max_length = std::max(max_length, next_length);
+        }
+
+        HuffmanTableEntry entry = {(int32_t)table.size(), HuffmanEntryKind::SubTable, 0, 0, 0};
+        entry.length = bits;
+        entry.extra = std::min(max_length - bits, kMaxTableSize);
+
+        table[pos + (is_LE ? ReverseN(prefix, bits) : prefix)] = entry;
+        table.resize(table.size() + (1 << entry.extra), {0, HuffmanEntryKind::Invalid, 0, 0, 0});
+        FillTableCodes(codes + i, last - i, entry.value, entry.extra, skip + bits, is_LE);
+
+        i = last;
     }
-    else {
-        if (depth == table_size) {
-            table[0].length = table_size + 1;
-            table[0].value = node;
-        } else {
-            MakeTableRecursBE(LeftBranch(node), table, depth + 1);
-            MakeTableRecursBE(RightBranch(node), table + curr_table_size/2, depth + 1);
+}
+
+
+// Merge the entries of the root table into pairs (when possible).
+void HuffmanDecoder::MakePairs(bool is_LE, int pair_limit)
+{
+    uint32_t mask = (1u << table_size) - 1;
+
+    for (uint32_t i = 0; i <= mask; i++) {
+        HuffmanTableEntry &entry = table[i];
+        if (entry.kind != HuffmanEntryKind::Symbol || entry.value >= pair_limit)
+            continue;
+
+        // Look at the entry of the bits following the first code.
+        uint32_t next = is_LE ? i >> entry.length : (i << entry.length) & mask;
+        const HuffmanTableEntry &second = table[next];
+
+        if (second.kind <= HuffmanEntryKind::Pair && second.value < pair_limit
+                && entry.length + second.length <= table_size) {
+            entry.kind = HuffmanEntryKind::Pair;
+            entry.extra = entry.length + second.length;
+            entry.value2 = second.value;
         }
     }
 }
 
 
 // Make the search table.
-void HuffmanDecoder::MakeTable(bool is_LE)
+// Symbols below |pair_limit| (<= 256) are decoded by pairs when possible.
+void HuffmanDecoder::MakeTable(bool is_LE, int pair_limit)
 {
-    constexpr int kMaxTableSize = 10;
+    // Root tables with pairs are larger (so two codes fit in more indexes).
+    int max_size = pair_limit > 0 ? kMaxPairTableSize : kMaxTableSize;
 
     if (max_length < min_length) table_size = kMaxTableSize;
-    else if (max_length >= kMaxTableSize) table_size = kMaxTableSize;
+    else if (max_length >= max_size) table_size = max_size;
     else table_size = max_length;
 
-    table = std::make_unique<HuffmanTableEntry[]>(1 << table_size);
+    table.assign(1 << table_size, {0, HuffmanEntryKind::Invalid, 0, 0, 0});
+
+    if (tree.empty())
+        FillTableCodes(codes.data(), codes.size(), 0, table_size, 0, is_LE);
+    else
+        FillTable(0, 0, table_size, 0, 0, is_LE, false);
 
-    if (is_LE) MakeTableRecursLE(0, table.get(), 0);
-    else MakeTableRecursBE(0, table.get(), 0);
+    if (pair_limit > 0)
+        MakePairs(is_LE, pair_limit);
 }
 
 
@@ -37,9 +37,29 @@ struct HuffmanTreeNode {
     int branches[2];
 };
 
+// A canonical code (built from code lengths).
+struct HuffmanCode {
+    int symbol;
+    uint32_t code; // Bits of the code (first bit is the high bit).
+    int length;
+};
+
+// Kind of an entry in the search table.
+enum class HuffmanEntryKind : uint8_t {
+    Symbol, // A single symbol.
+    Pair, // Two symbols (the second one is decoded with the same code).
+    SubTable, // Look at the next bits in a sub-table.
+    Node, // Walk the tree from a node (for very long or repeating codes).
+    Invalid // Invalid prefix code.
+};
+
+// An entry in the search table.
 struct HuffmanTableEntry {
-    uint32_t length;
-    int32_t value;
+    int32_t value; // Symbol, sub-table position or node.
+    HuffmanEntryKind kind;
+    uint8_t length; // Length of the (first) code or of the table index.
+    uint8_t extra; // Length of all the codes (symbols, pairs) or sub-table index size.
+    uint8_t value2; // Second symbol (for pairs).
 };
 
 
@@ -47,11 +67,10 @@ struct HuffmanTableEntry {
 // Huffman code decoder.
 struct HuffmanDecoder {
 
-    // Copy an Huffman decoder.
-    HuffmanDecoder &operator=(const HuffmanDecoder &);
-
     // Initialize the decoder.
     void Initialize();
+
+    // Initialize the decoder with a canonical code (no tree is built).
     void Initialize(const int *lengths, int numsymbols, int maxcodelength, bool zeros);
 
 
@@ -65,56 +84,81 @@ struct HuffmanDecoder {
 
 
     // Get the next symbol from a bit reader.
-    int NextSymbol(utils::BitReader &input);
+    template <utils::Endian E>
+    int NextSymbol(utils::BitReader<E> &input) const;
+
+    // Get the next one or two symbols from a bit reader.
+    // Return the number of symbols read.
+    template <utils::Endian E>
+    int NextSymbols(utils::BitReader<E> &input, int *symbols) const;
 
     // Make the search table.
-    void MakeTable(bool is_LE);
+    // Symbols below |pair_limit| (<= 256) are decoded by pairs when possible.
+    void MakeTable(bool is_LE, int pair_limit = 0);
 
 protected:
 
     // Get a pointer on a node.
     HuffmanTreeNode *NodePtr(int node) { return &tree[node]; }
+    const HuffmanTreeNode *NodePtr(int node) const { return &tree[node]; }
 
     // Get/set node ID on branch |bit| of |node|.
-    int Branch(int node, int bit) { return NodePtr(node)->branches[bit]; }
+    int Branch(int node, int bit) const { return NodePtr(node)->branches[bit]; }
     void SetBranch(int node, int bit, int next) { NodePtr(node)->branches[bit] = next; }
 
     // Get/set left branch of |node|.
-    int LeftBranch(int node) { return Branch(node, 0); }
+    int LeftBranch(int node) const { return Branch(node, 0); }
     void SetLeftBranch(int node, int next) { SetBranch(node, 0, next); }
 
     // Get/set right branch of |node|.
-    int RightBranch(int node) { return Branch(node, 1); }
+    int RightBranch(int node) const { return Branch(node, 1); }
     void SetRightBranch(int node, int next) { SetBranch(node, 1, next); }
 
     // Get/set leaf value.
-    int LeafValue(int node) { return LeftBranch(node); }
+    int LeafValue(int node) const { return LeftBranch(node); }
     void SetLeafValue(int node, int v) { SetLeftBranch(node, v); SetRightBranch(node, v); }
 
     // Set/get whether a node is empty or not.
     void SetEmptyNode(int node) { SetLeftBranch(node, -1); SetRightBranch(node, -2); }
-    bool IsEmptyNode(int node) { return LeftBranch(node) == -1 && RightBranch(node) == -2; }
+    bool IsEmptyNode(int node) const { return LeftBranch(node) == -1 && RightBranch(node) == -2; }
 
     // Get information on a node.
-    bool IsInvalidNode(int node) { return node < 0; }
-    bool IsOpenBranch(int node, int bit) { return IsInvalidNode(Branch(node, bit)); }
-    bool IsLeafNode(int node) { return LeftBranch(node) == RightBranch(node); }
+    bool IsInvalidNode(int node) const { return node < 0; }
+    bool IsOpenBranch(int node, int bit) const { return IsInvalidNode(Branch(node, bit)); }
+    bool IsLeafNode(int node) const { return LeftBranch(node) == RightBranch(node); }
 
     // Create a new node.
     int NewNode() { tree.push_back({0}); SetEmptyNode(tree.size()-1);
         return tree.size()-1; }
 
 
-    // Make search table.
-    void MakeTableRecursLE(int node, HuffmanTableEntry *table, int depth);
-    void MakeTableRecursBE(int node, HuffmanTableEntry *table, int depth);
+    // Get the symbol of an entry of the root table (and skip its bits).
+    template <utils::Endian E>
+    int EntrySymbol(utils::BitReader<E> &input, const HuffmanTableEntry *entry) const;
+
+    // Get the depth of a sub-tree (at most |limit|).
+    int SubTreeDepth(int node, int limit) const;
+
+    // Fill the entries of the table at |pos| (index size of |bits|) for the
+    // sub-tree |node|, found at |depth| with the bits of |prefix|.
+    void FillTable(int node, uint32_t pos, int bits, int depth, uint32_t prefix,
+        bool is_LE, bool sub_table);
+
+    // Fill the entries of the table at |pos| (index size of |bits|) for the
+    // canonical |codes| (sorted), after their first |skip| bits.
+    void FillTableCodes(const HuffmanCode *codes, int num_codes, uint32_t pos,
+        int bits, int skip, bool is_LE);
+
+    // Merge the entries of the root table into pairs (when possible).
+    void MakePairs(bool is_LE, int pair_limit);
 
 
     std::vector<HuffmanTreeNode> tree;
+    std::vector<HuffmanCode> codes; // Canonical codes, sorted by code.
     int num_entries, min_length, max_length;
 
-    int table_size;
-    std::unique_ptr<HuffmanTableEntry[]> table;
+    int table_size; // Index size of the root table.
+    std::vector<HuffmanTableEntry> table; // Root table, then sub-tables.
 };
 
 
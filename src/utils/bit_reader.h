@@ -21,12 +21,20 @@ this program.  If not, see <https://www.gnu.org/licenses/>.
 #pragma once
 
 #include <inttypes.h>
+#include <string.h>
 
 namespace maconv {
 namespace utils {
 
 
+// Byte order of the integers read by a BitReader.
+enum class Endian { Big, Little };
+
+
 // Read a buffer by group of bits (not necessarily multiple of 8).
+// Bits are cached in a 64-bit integer, refilled by unaligned 8-byte loads;
+// bits read past the end of the buffer are zeros.
+template <Endian E>
 struct BitReader {
 
     // Load a buffer of |length| in the reader.
@@ -34,66 +42,122 @@ struct BitReader {
 
 
     // Is the reader at end?
-    bool HasEnded(int n = 0) { return data == end && num_bits <= n; }
+    bool HasEnded(int n = 0) const { return data == end && num_bits <= n; }
 
     // Ignore a number of bits (n can be > 32).
     void IgnoreBits(int n);
 
 
     // Read a single bit.
-    virtual uint8_t ReadBit() { return ReadWord(1); };
-
-    // Read a word (i.e. n <= 25 bits).
-    virtual uint32_t ReadWord(int n, bool skip = true) = 0;
+    uint8_t ReadBit() { return ReadWord(1); }
 
-    // Read a long word (n can be > 25).
-    virtual uint32_t ReadLongWord(int n, bool skip = true) = 0;
+    // Read a word (i.e. n <= 32 bits).
+    uint32_t ReadWord(int n, bool skip = true);
 
     // Skip some bits (that has been readed).
-    virtual void SkipBits(int n) = 0;
+    void SkipBits(int n);
+
+    // Refill the bit cache (with at least 57 bits if possible).
+    void FillBitCache();
 
 
     uint8_t *data; // Current pointer on data.
     uint8_t *end; // Length of the buffer.
 
-    uint32_t bits = 0; // Bit cache.
+    // Bit cache: the next bits are the highest ones for Big Endian and the
+    // lowest ones for Little Endian.
+    uint64_t bits = 0;
     int num_bits = 0; // Number of bits in the cache.
 };
 
 
-
 // BitReader that reads Big Endian integers.
-struct BitReaderBE : BitReader {
-
-    // Read a word (i.e. <= 32 bits).
-    uint32_t ReadWord(int n, bool skip = true) override;
-
-    // Read a long word (n can be > 25 bits).
-    uint32_t ReadLongWord(int n, bool skip = true) override;
-
-    // Skip some bits (that has been readed).
-    void SkipBits(int n) override;
-
-    // Refill the bit cache.
-    void FillBitCache();
-};
-
+using BitReaderBE = BitReader<Endian::Big>;
 
 // BitReader that reads Little Endian integers.
-struct BitReaderLE : BitReader {
-
-    // Read a word (i.e. <= 25 bits).
-    uint32_t ReadWord(int n, bool skip = true) override;
-
-    // Read a long word (n can be > 25 bits).
-    uint32_t ReadLongWord(int n, bool skip = true) override;
-
-    // Skip some bits (that has been readed).
-    void SkipBits(int n) override;
-
-    // Refill the bit cache.
-    void FillBitCache();
-};
+using BitReaderLE = BitReader<Endian::Little>;
+
+
+
+// Load a buffer of |length| in the reader.
+template <Endian E>
+inline void BitReader<E>::Load(uint8_t *data, int length)
+{
+    this->data = data;
+    this->end = data + length;
+
+    bits = 0;
+    num_bits = 0;
+}
+
+
+// Ignore a number of bits (n can be > 32).
+template <Endian E>
+inline void BitReader<E>::IgnoreBits(int n)
+{
+    for (; n > 0; n -= 32)
+        ReadWord(n < 32 ? n : 32);
+}
+
+
+// Read a word (i.e. n <= 32 bits).
+template <Endian E>
+inline uint32_t BitReader<E>::ReadWord(int n, bool skip)
+{
+    if (n > num_bits)
+        FillBitCache();
+
+    uint32_t ret;
+    if (E == Endian::Big)
+        ret = (bits >> 1) >> (63 - n); // Also valid for n = 0.
+    else
+        ret = bits & (((uint64_t)1 << n) - 1);
+
+    if (skip) SkipBits(n);
+    return ret;
+}
+
+
+// Skip some bits (that has been readed).
+template <Endian E>
+inline void BitReader<E>::SkipBits(int n)
+{
+    if (E == Endian::Big)
+        bits <<= n;
+    else
+        bits >>= n;
+
+    num_bits -= n;
+}
+
+
+// Refill the bit cache (with at least 57 bits if possible).
+template <Endian E>
+inline void BitReader<E>::FillBitCache()
+{
+    // Fast path: load 8 bytes and keep the whole bytes that fit.
+    if (end - data >= 8) {
+        uint64_t word;
+        memcpy(&word, data, 8);
+
+        if (E == Endian::Big)
+            bits |= __builtin_bswap64(word) >> num_bits;
+        else
+            bits |= word << num_bits;
+
+        data += (63 - num_bits) >> 3;
+        num_bits |= 56;
+        return;
+    }
+
+    // End of the buffer: load the remaining bytes one by one.
+    for (; num_bits <= 56 && data != end; num_bits += 8) {
+        if (E == Endian::Big)
+            bits |= (uint64_t)*(data++) << (56 - num_bits);
+        else
+            bits |= (uint64_t)*(data++) << num_bits;
+    }
+}
 
 
 } // namespace utils
@@ -34,53 +34,148 @@
 
 # define INUSE(b)	((b)->flags & HFS_BUCKET_INUSE)
 # define DIRTY(b)	((b)->flags & HFS_BUCKET_DIRTY)
+# define HOT(b)		((b)->flags & HFS_BUCKET_HOT)
+
+# define NOBLOCK	((unsigned long) -1)
+
+# define HASHSZ(cache)	(1U << (cache)->hbits)
+# define KEY(cache, id)	((id) < (cache)->size ? (cache)->chain[id].bnum :  \
+			 (cache)->ghost[(id) - (cache)->size])
+
+/*
+ * NAME:	freecache()
+ * DESCRIPTION:	free a block cache and its tables
+ */
+static
+void freecache(bcache *cache)
+{
+  FREE(cache->chain);
+  FREE(cache->list);
+  FREE(cache->pool);
+  FREE(cache->ghost);
+  FREE(cache->hash);
+
+  FREE(cache);
+}
+
+/*
+ * NAME:	qinit()
+ * DESCRIPTION:	make an empty cache queue
+ */
+static
+void qinit(bucket *q)
+{
+  q->flags = 0;
+  q->bnum  = NOBLOCK;
+  q->data  = 0;
+
+  q->cnext = q;
+  q->cprev = q;
+}
+
+/*
+ * NAME:	qunlink()
+ * DESCRIPTION:	remove a bucket from its cache queue
+ */
+static
+void qunlink(bucket *b)
+{
+  b->cnext->cprev = b->cprev;
+  b->cprev->cnext = b->cnext;
+}
+
+/*
+ * NAME:	qpush()
+ * DESCRIPTION:	insert a bucket at the head of a cache queue
+ */
+static
+void qpush(bucket *q, bucket *b)
+{
+  b->cprev = q;
+  b->cnext = q->cnext;
+
+  q->cnext->cprev = b;
+  q->cnext = b;
+}
 
 /*
  * NAME:	block->init()
  * DESCRIPTION:	initialize a volume's block cache
  */
-int b_init(hfsvol *vol)
+int b_init(hfsvol *vol, unsigned long size)
 {
   bcache *cache;
-  int i;
+  unsigned int i;
 
   ASSERT(vol->cache == 0);
 
+  if (size < HFS_BLOCKBUFSZ)
+    size = HFS_BLOCKBUFSZ;
+  else if (size > HFS_CACHEMAX)
+    size = HFS_CACHEMAX;
+
   cache = ALLOC(bcache, 1);
   if (cache == 0)
     ERROR(ENOMEM, 0);
 
-  vol->cache = cache;
-
   cache->vol    = vol;
-  cache->tail   = &cache->chain[HFS_CACHESZ - 1];
+  cache->size   = size;
 
   cache->hits   = 0;
   cache->misses = 0;
 
-  for (i = 0; i < HFS_CACHESZ; ++i)
+  /* 2Q tuning: a quarter of the buckets hold blocks seen once, and the
+     blocks evicted from them are remembered for half a cache more */
+
+  cache->ncold  = 0;
+  cache->kin    = cache->size >> 2;
+
+  cache->gsize  = cache->size >> 1;
+  cache->gnext  = 0;
+
+  /* keep the hash table at most half full */
+
+  for (cache->hbits = 1;
+       HASHSZ(cache) < (cache->size + cache->gsize) << 1; ++cache->hbits)
+    ;
+
+  cache->chain = ALLOC(bucket, cache->size);
+  cache->list  = ALLOC(bucket *, cache->size);
+  cache->pool  = ALLOC(block, cache->size);
+  cache->ghost = ALLOC(unsigned long, cache->gsize);
+  cache->hash  = ALLOC(unsigned int, HASHSZ(cache));
+
+  if (cache->chain == 0 || cache->list == 0 || cache->pool == 0 ||
+      cache->ghost == 0 || cache->hash == 0)
+    {
+      freecache(cache);
+      ERROR(ENOMEM, 0);
+    }
+
+  qinit(&cache->idle);
+  qinit(&cache->cold);
+  qinit(&cache->hot);
+
+  for (i = 0; i < cache->size; ++i)
     {
       bucket *b = &cache->chain[i];
 
       b->flags = 0;
-      b->count = 0;
 
-      b->bnum  = 0;
+      b->bnum  = NOBLOCK;
       b->data  = &cache->pool[i];
 
-      b->cnext = b + 1;
-      b->cprev = b - 1;
-
-      b->hnext = 0;
-      b->hprev = 0;
+      qpush(&cache->idle, b);
     }
 
-  cache->chain[0].cprev = cache->tail;
-  cache->tail->cnext    = &cache->chain[0];
+  for (i = 0; i < cache->gsize; ++i)
+    cache->ghost[i] = NOBLOCK;
 
-  for (i = 0; i < HFS_HASHSZ; ++i)
+  for (i = 0; i < HASHSZ(cache); ++i)
     cache->hash[i] = 0;
 
+  vol->cache = cache;
+
   return 0;
 
 fail:
@@ -94,65 +189,108 @@ fail:
  */
 void b_showstats(const bcache *cache)
 {
-  fprintf(stderr, "BLOCK: CACHE vol 0x%lx \"%s\" hit/miss ratio = %.3f\n",
+  fprintf(stderr, "BLOCK: CACHE vol 0x%lx \"%s\" hit/miss ratio = %.3f "
+	  "(%lu/%lu, %u blocks)\n",
 	  (unsigned long) cache->vol, cache->vol->mdb.drVN,
-	  (float) cache->hits / (float) cache->misses);
+	  (float) cache->hits / (float) cache->misses,
+	  cache->hits, cache->misses, cache->size);
 }
 
 /*
  * NAME:	block->dumpcache()
- * DESCRIPTION:	dump the cache tables for a volume
+ * DESCRIPTION:	dump the cache queues for a volume
  */
 void b_dumpcache(const bcache *cache)
 {
-  const bucket *b;
-  int i;
+  const bucket *q, *b;
+  unsigned int i;
 
   fprintf(stderr, "BLOCK CACHE DUMP:\n");
 
-  for (i = 0, b = cache->tail->cnext; i < HFS_CACHESZ; ++i, b = b->cnext)
+  for (i = 0; i < 2; ++i)
     {
-      if (INUSE(b))
+      q = i ? &cache->hot : &cache->cold;
+
+      fprintf(stderr, "  %s:", i ? "hot" : "cold");
+
+      for (b = q->cnext; b != q; b = b->cnext)
 	{
-	  fprintf(stderr, "\t %lu", b->bnum);
+	  fprintf(stderr, " %lu", b->bnum);
 	  if (DIRTY(b))
 	    fprintf(stderr, "*");
-
-	  fprintf(stderr, ":%u", b->count);
 	}
-    }
 
-  fprintf(stderr, "\n");
+      fprintf(stderr, "\n");
+    }
 
-  fprintf(stderr, "BLOCK HASH DUMP:\n");
+  fprintf(stderr, "BLOCK GHOST DUMP:\n ");
 
-  for (i = 0; i < HFS_HASHSZ; ++i)
+  for (i = 0; i < cache->gsize; ++i)
     {
-      int seen = 0;
+      if (cache->ghost[i] != NOBLOCK)
+	fprintf(stderr, " %lu", cache->ghost[i]);
+    }
 
-      for (b = cache->hash[i]; b; b = b->hnext)
-	{
-	  if (! seen)
-	    fprintf(stderr, "  %d:", i);
+  fprintf(stderr, "\n");
+}
+# endif
 
-	  if (INUSE(b))
-	    {
-	      fprintf(stderr, " %lu", b->bnum);
-	      if (DIRTY(b))
-		fprintf(stderr, "*");
+/*
+ * NAME:	readpbv()
+ * DESCRIPTION:	read blocks from the physical medium into scattered buffers
+ */
+static
+int readpbv(hfsvol *vol, unsigned long bnum, block *const *bufs,
+	    unsigned int blen)
+{
+  unsigned long nblocks;
 
-	      fprintf(stderr, ":%u", b->count);
-	    }
+# ifdef DEBUG
+  fprintf(stderr, "BLOCK: READV vol 0x%lx block %lu+%u[..%lu]\n",
+	  (unsigned long) vol, bnum, blen - 1, bnum + blen - 1);
+# endif
 
-	  seen = 1;
-	}
+  nblocks = os_readv(&vol->priv, bnum, bufs, blen);
+  if (nblocks == (unsigned long) -1)
+    goto fail;
 
-      if (seen)
-	fprintf(stderr, "\n");
-    }
+  if (nblocks != blen)
+    ERROR(EIO, "incomplete block read");
+
+  return 0;
+
+fail:
+  return -1;
 }
+
+/*
+ * NAME:	writepbv()
+ * DESCRIPTION:	write blocks to the physical medium from scattered buffers
+ */
+static
+int writepbv(hfsvol *vol, unsigned long bnum, const block *const *bufs,
+	     unsigned int blen)
+{
+  unsigned long nblocks;
+
+# ifdef DEBUG
+  fprintf(stderr, "BLOCK: WRITEV vol 0x%lx block %lu+%u[..%lu]\n",
+	  (unsigned long) vol, bnum, blen - 1, bnum + blen - 1);
 # endif
 
+  nblocks = os_writev(&vol->priv, bnum, bufs, blen);
+  if (nblocks == (unsigned long) -1)
+    goto fail;
+
+  if (nblocks != blen)
+    ERROR(EIO, "incomplete block write");
+
+  return 0;
+
+fail:
+  return -1;
+}
+
 /*
  * NAME:	fillchain()
  * DESCRIPTION:	fill a chain of bucket buffers with a single read
@@ -161,6 +299,7 @@ static
 int fillchain(hfsvol *vol, bucket **bptr, unsigned int *count)
 {
   bucket *blist[HFS_BLOCKBUFSZ], **start = bptr;
+  block *bufs[HFS_BLOCKBUFSZ];
   unsigned long bnum;
   unsigned int len, i;
 
@@ -173,6 +312,7 @@ int fillchain(hfsvol *vol, bucket **bptr, unsigned int *count)
       if (len > 0 && (*bptr)->bnum != bnum)
 	break;
 
+      bufs[len]    = (*bptr)->data;
       blist[len++] = *bptr;
       bnum = (*bptr)->bnum + 1;
     }
@@ -189,13 +329,8 @@ int fillchain(hfsvol *vol, bucket **bptr, unsigned int *count)
     }
   else
     {
-      block buffer[HFS_BLOCKBUFSZ];
-
-      if (b_readpb(vol, vol->vstart + blist[0]->bnum, buffer, len) == -1)
+      if (readpbv(vol, vol->vstart + blist[0]->bnum, bufs, len) == -1)
 	goto fail;
-
-      for (i = 0; i < len; ++i)
-	memcpy(blist[i]->data, buffer[i], HFS_BLOCKSZ);
     }
 
   for (i = 0; i < len; ++i)
@@ -219,6 +354,7 @@ static
 int flushchain(hfsvol *vol, bucket **bptr, unsigned int *count)
 {
   bucket *blist[HFS_BLOCKBUFSZ], **start = bptr;
+  const block *bufs[HFS_BLOCKBUFSZ];
   unsigned long bnum;
   unsigned int len, i;
 
@@ -231,6 +367,7 @@ int flushchain(hfsvol *vol, bucket **bptr, unsigned int *count)
       if (len > 0 && (*bptr)->bnum != bnum)
 	break;
 
+      bufs[len]    = (*bptr)->data;
       blist[len++] = *bptr;
       bnum = (*bptr)->bnum + 1;
     }
@@ -247,12 +384,7 @@ int flushchain(hfsvol *vol, bucket **bptr, unsigned int *count)
     }
   else
     {
-      block buffer[HFS_BLOCKBUFSZ];
-
-      for (i = 0; i < len; ++i)
-	memcpy(buffer[i], blist[i]->data, HFS_BLOCKSZ);
-
-      if (b_writepb(vol, vol->vstart + blist[0]->bnum, buffer, len) == -1)
+      if (writepbv(vol, vol->vstart + blist[0]->bnum, bufs, len) == -1)
 	goto fail;
     }
 
@@ -319,16 +451,18 @@ int dobuckets(hfsvol *vol, bucket **chain, unsigned int len,
 int b_flush(hfsvol *vol)
 {
   bcache *cache = vol->cache;
-  bucket *chain[HFS_CACHESZ];
-  int i;
+  unsigned int len, i;
 
   if (cache == 0 || (vol->flags & HFS_VOL_READONLY))
     goto done;
 
-  for (i = 0; i < HFS_CACHESZ; ++i)
-    chain[i] = &cache->chain[i];
+  for (len = 0, i = 0; i < cache->size; ++i)
+    {
+      if (DIRTY(&cache->chain[i]))
+	cache->list[len++] = &cache->chain[i];
+    }
 
-  if (flushbuckets(vol, chain, HFS_CACHESZ) == -1)
+  if (flushbuckets(vol, cache->list, len) == -1)
     goto fail;
 
 done:
@@ -360,7 +494,7 @@ int b_finish(hfsvol *vol)
 
   result = b_flush(vol);
 
-  FREE(vol->cache);
+  freecache(vol->cache);
   vol->cache = 0;
 
 done:
@@ -368,113 +502,145 @@ done:
 }
 
 /*
- * NAME:	findbucket()
- * DESCRIPTION:	locate a bucket in the cache, and/or its hash slot
+ * NAME:	hashof()
+ * DESCRIPTION:	return the home slot of a block in the hash table
  */
 static
-bucket *findbucket(bcache *cache, unsigned long bnum, bucket ***hslot)
+unsigned int hashof(const bcache *cache, unsigned long bnum)
 {
-  bucket *b;
+  /* Fibonacci hashing spreads runs of consecutive blocks */
 
-  *hslot = &cache->hash[bnum & (HFS_HASHSZ - 1)];
+  return ((bnum * 0x9e3779b1UL) & 0xffffffffUL) >> (32 - cache->hbits);
+}
 
-  for (b = **hslot; b; b = b->hnext)
+/*
+ * NAME:	findslot()
+ * DESCRIPTION:	locate the hash slot of a block, or the empty slot to hold it
+ */
+static
+unsigned int findslot(const bcache *cache, unsigned long bnum)
+{
+  unsigned int mask = HASHSZ(cache) - 1, i;
+
+  for (i = hashof(cache, bnum); cache->hash[i]; i = (i + 1) & mask)
     {
-      if (INUSE(b) && b->bnum == bnum)
+      if (KEY(cache, cache->hash[i] - 1) == bnum)
 	break;
     }
 
-  return b;
+  return i;
 }
 
 /*
- * NAME:	reuse()
- * DESCRIPTION:	free a bucket for reuse, flushing if necessary
+ * NAME:	hremove()
+ * DESCRIPTION:	empty a hash slot, moving back the entries probed past it
  */
 static
-int reuse(bcache *cache, bucket *b, unsigned long bnum)
+void hremove(bcache *cache, unsigned int i)
 {
-  bucket *chain[HFS_BLOCKBUFSZ], *bptr;
-  int i;
-
-# ifdef DEBUG
-  if (INUSE(b))
-    fprintf(stderr, "BLOCK: CACHE reusing bucket containing "
-	    "vol 0x%lx block %lu:%u\n",
-	    (unsigned long) cache->vol, b->bnum, b->count);
-# endif
+  unsigned int mask = HASHSZ(cache) - 1, j, k;
 
-  if (INUSE(b) && DIRTY(b))
+  for (j = i; ; i = j)
     {
-      /* flush most recently unused buckets */
+      cache->hash[i] = 0;
 
-      for (bptr = b, i = 0; i < HFS_BLOCKBUFSZ; ++i)
+      do
 	{
-	  chain[i] = bptr;
-	  bptr = bptr->cprev;
+	  j = (j + 1) & mask;
+	  if (cache->hash[j] == 0)
+	    return;
+
+	  k = hashof(cache, KEY(cache, cache->hash[j] - 1));
 	}
+      while (i <= j ? (i < k && k <= j) : (i < k || k <= j));
 
-      if (flushbuckets(cache->vol, chain, HFS_BLOCKBUFSZ) == -1)
-	goto fail;
+      cache->hash[i] = cache->hash[j];
     }
-
-  b->flags &= ~HFS_BUCKET_INUSE;
-  b->count  = 1;
-  b->bnum   = bnum;
-
-  return 0;
-
-fail:
-  return -1;
 }
 
 /*
- * NAME:	cplace()
- * DESCRIPTION:	move a bucket to an appropriate place near head of the chain
+ * NAME:	remember()
+ * DESCRIPTION:	replace an evicted cold bucket by a ghost entry
  */
 static
-void cplace(bcache *cache, bucket *b)
+void remember(bcache *cache, const bucket *b)
 {
-  bucket *p;
+  unsigned int g = cache->gnext;
 
-  for (p = cache->tail->cnext; p->count > 1; p = p->cnext)
-    --p->count;
+  if (cache->ghost[g] != NOBLOCK)
+    hremove(cache, findslot(cache, cache->ghost[g]));
 
-  b->cnext->cprev = b->cprev;
-  b->cprev->cnext = b->cnext;
+  /* the ghost takes over the hash slot of the bucket */
 
-  if (cache->tail == b)
-    cache->tail = b->cprev;
+  cache->hash[findslot(cache, b->bnum)] = cache->size + g + 1;
+  cache->ghost[g] = b->bnum;
 
-  b->cprev = p->cprev;
-  b->cnext = p;
-
-  p->cprev->cnext = b;
-  p->cprev = b;
+  cache->gnext = (g + 1) % cache->gsize;
 }
 
 /*
- * NAME:	hplace()
- * DESCRIPTION:	move a bucket to the head of its hash slot
+ * NAME:	reclaim()
+ * DESCRIPTION:	take a bucket for reuse, flushing if necessary
  */
 static
-void hplace(bucket **hslot, bucket *b)
+bucket *reclaim(bcache *cache)
 {
-  if (*hslot != b)
+  bucket *q, *b, *bptr, *chain[HFS_BLOCKBUFSZ];
+  unsigned int len;
+
+  b = cache->idle.cnext;
+
+  if (b != &cache->idle)
     {
-      if (b->hprev)
-	*b->hprev = b->hnext;
-      if (b->hnext)
-	b->hnext->hprev = b->hprev;
+      qunlink(b);
+      return b;
+    }
+
+  /* evict from the cold queue while it holds more than its share, so that
+     blocks only seen once (such as fork data) never push out hot ones */
+
+  if (cache->ncold > cache->kin || cache->hot.cnext == &cache->hot)
+    q = &cache->cold;
+  else
+    q = &cache->hot;
 
-      b->hprev = hslot;
-      b->hnext = *hslot;
+  b = q->cprev;
 
-      if (*hslot)
-	(*hslot)->hprev = &b->hnext;
+# ifdef DEBUG
+  fprintf(stderr, "BLOCK: CACHE reusing %s bucket containing "
+	  "vol 0x%lx block %lu\n", q == &cache->cold ? "cold" : "hot",
+	  (unsigned long) cache->vol, b->bnum);
+# endif
 
-      *hslot = b;
+  if (DIRTY(b))
+    {
+      /* flush least recently used buckets of the same queue */
+
+      for (bptr = b, len = 0; len < HFS_BLOCKBUFSZ && bptr != q; ++len)
+	{
+	  chain[len] = bptr;
+	  bptr = bptr->cprev;
+	}
+
+      if (flushbuckets(cache->vol, chain, len) == -1)
+	goto fail;
     }
+
+  if (q == &cache->cold)
+    {
+      remember(cache, b);
+      --cache->ncold;
+    }
+  else
+    hremove(cache, findslot(cache, b->bnum));
+
+  qunlink(b);
+  b->flags = 0;
+
+  return b;
+
+fail:
+  return 0;
 }
 
 /*
@@ -484,91 +650,96 @@ void hplace(bucket **hslot, bucket *b)
 static
 bucket *getbucket(bcache *cache, unsigned long bnum, int fill)
 {
-  bucket **hslot, *b, *p, *bptr,
-    *chain[HFS_BLOCKBUFSZ], **slots[HFS_BLOCKBUFSZ];
+  bucket *b, *chain[HFS_BLOCKBUFSZ >> 1];
+  unsigned int slot, id, len = 0, i;
+  int hot = 0;
 
-  b = findbucket(cache, bnum, &hslot);
+  slot = findslot(cache, bnum);
+  id   = cache->hash[slot];
 
-  if (b)
+  if (id > 0 && id <= cache->size)
     {
-      /* cache hit; move towards head of cache chain */
+      /* cache hit; only hot blocks move, cold ones age in FIFO order */
 
       ++cache->hits;
 
-      if (++b->count > b->cprev->count &&
-	  b != cache->tail->cnext)
+      b = &cache->chain[id - 1];
+
+      if (HOT(b))
 	{
-	  p = b->cprev;
+	  qunlink(b);
+	  qpush(&cache->hot, b);
+	}
 
-	  p->cprev->cnext = b;
-	  b->cnext->cprev = p;
+      return b;
+    }
 
-	  p->cnext = b->cnext;
-	  b->cprev = p->cprev;
+  /* cache miss; a block requested again soon after eviction becomes hot */
 
-	  p->cprev = b;
-	  b->cnext = p;
+  ++cache->misses;
 
-	  if (cache->tail == b)
-	    cache->tail = p;
-	}
-    }
-  else
+  if (id > 0)
     {
-      /* cache miss; reuse least-used cache bucket */
+      cache->ghost[id - 1 - cache->size] = NOBLOCK;
+      hremove(cache, slot);
 
-      ++cache->misses;
+      hot = 1;
+    }
 
-      b = cache->tail;
+  b = reclaim(cache);
+  if (b == 0)
+    goto fail;
 
-      if (reuse(cache, b, bnum) == -1)
-	goto fail;
+  b->bnum = bnum;
+  chain[len++] = b;
 
-      if (fill)
-	{
-	  unsigned int len = 0;
+  if (fill)
+    {
+      /* read ahead following blocks neither cached nor remembered */
 
-	  chain[len]   = b;
-	  slots[len++] = hslot;
+      while (len < (HFS_BLOCKBUFSZ >> 1) && ++bnum < cache->vol->vlen &&
+	     cache->hash[findslot(cache, bnum)] == 0)
+	{
+	  chain[len] = reclaim(cache);
+	  if (chain[len] == 0)
+	    goto fail;
 
-	  for (bptr = b->cprev;
-	       len < (HFS_BLOCKBUFSZ >> 1) && ++bnum < cache->vol->vlen;
-	       bptr = bptr->cprev)
-	    {
-	      if (findbucket(cache, bnum, &hslot))
-		break;
+	  chain[len++]->bnum = bnum;
+	}
 
-	      if (reuse(cache, bptr, bnum) == -1)
-		goto fail;
+      if (fillbuckets(cache->vol, chain, len) == -1)
+	goto fail;
+    }
 
-	      chain[len]   = bptr;
-	      slots[len++] = hslot;
-	    }
+  /* read-ahead blocks go behind the requested one in the cold queue */
 
-	  if (fillbuckets(cache->vol, chain, len) == -1)
-	    goto fail;
+  for (i = len; i-- > 0; )
+    {
+      b = chain[i];
 
-	  while (--len)
-	    {
-	      cplace(cache, chain[len]);
-	      hplace(slots[len], chain[len]);
-	    }
+      cache->hash[findslot(cache, b->bnum)] = b - cache->chain + 1;
 
-	  hslot = slots[0];
+      if (i == 0 && hot)
+	{
+	  b->flags |= HFS_BUCKET_HOT;
+	  qpush(&cache->hot, b);
+	}
+      else
+	{
+	  qpush(&cache->cold, b);
+	  ++cache->ncold;
 	}
-
-      /* move bucket to appropriate place in chain */
-
-      cplace(cache, b);
     }
 
-  /* insert at front of hash chain */
-
-  hplace(hslot, b);
-
   return b;
 
 fail:
+  while (len-- > 0)
+    {
+      chain[len]->flags = 0;
+      qpush(&cache->idle, chain[len]);
+    }
+
   return 0;
 }
 
@@ -589,14 +760,7 @@ int b_readpb(hfsvol *vol, unsigned long bnum, block *bp, unsigned int blen)
     fprintf(stderr, "\n");
 # endif
 
-  nblocks = os_seek(&vol->priv, bnum);
-  if (nblocks == (unsigned long) -1)
-    goto fail;
-
-  if (nblocks != bnum)
-    ERROR(EIO, "block seek failed for read");
-
-  nblocks = os_read(&vol->priv, bp, blen);
+  nblocks = os_read(&vol->priv, bnum, bp, blen);
   if (nblocks == (unsigned long) -1)
     goto fail;
 
@@ -627,14 +791,7 @@ int b_writepb(hfsvol *vol, unsigned long bnum, const block *bp,
     fprintf(stderr, "\n");
 # endif
 
-  nblocks = os_seek(&vol->priv, bnum);
-  if (nblocks == (unsigned long) -1)
-    goto fail;
-
-  if (nblocks != bnum)
-    ERROR(EIO, "block seek failed for write");
-
-  nblocks = os_write(&vol->priv, bp, blen);
+  nblocks = os_write(&vol->priv, bnum, bp, blen);
   if (nblocks == (unsigned long) -1)
     goto fail;
 
@@ -733,6 +890,47 @@ fail:
   return -1;
 }
 
+/*
+ * NAME:	block->readabs()
+ * DESCRIPTION:	read consecutive blocks from allocation blocks of a volume
+ *		straight into a buffer (bypassing cache)
+ */
+int b_readabs(hfsvol *vol, unsigned int anum, unsigned int index, block *bp,
+	      unsigned int blen)
+{
+  unsigned long bnum;
+  unsigned int last, i;
+
+  /* verify the allocation blocks exist and are marked as in-use */
+
+  last = anum + (index + blen - 1) / vol->lpa;
+
+  if (last >= vol->mdb.drNmAlBlks)
+    ERROR(EIO, "read nonexistent allocation block");
+
+  for (i = anum; vol->vbm && i <= last; ++i)
+    {
+      if (! BMTST(vol->vbm, i))
+	ERROR(EIO, "read unallocated block");
+    }
+
+  bnum = vol->mdb.drAlBlSt + anum * vol->lpa + index;
+
+  if (vol->vlen > 0 && bnum + blen > vol->vlen)
+    ERROR(EIO, "read nonexistent logical block");
+
+  /* the cache may hold blocks more recent than the medium */
+
+  if (! (vol->flags & HFS_VOL_READONLY) &&
+      b_flush(vol) == -1)
+    goto fail;
+
+  return b_readpb(vol, vol->vstart + bnum, bp, blen);
+
+fail:
+  return -1;
+}
+
 /*
  * NAME:	block->writeab()
  * DESCRIPTION:	write a block to an allocation block to a volume
@@ -765,7 +963,7 @@ unsigned long b_size(hfsvol *vol)
   unsigned long low, high, mid;
   block b;
 
-  high = os_seek(&vol->priv, -1);
+  high = os_size(&vol->priv);
 
   if (high != (unsigned long) -1 && high > 0)
     return high;
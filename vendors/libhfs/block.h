@@ -19,7 +19,7 @@
  * $Id: block.h,v 1.10 1998/11/02 22:08:53 rob Exp $
  */
 
-int b_init(hfsvol *);
+int b_init(hfsvol *, unsigned long);
 int b_flush(hfsvol *);
 int b_finish(hfsvol *);
 
@@ -30,6 +30,7 @@ int b_readlb(hfsvol *, unsigned long, block *);
 int b_writelb(hfsvol *, unsigned long, const block *);
 
 int b_readab(hfsvol *, unsigned int, unsigned int, block *);
+int b_readabs(hfsvol *, unsigned int, unsigned int, block *, unsigned int);
 int b_writeab(hfsvol *, unsigned int, unsigned int, const block *);
 
 unsigned long b_size(hfsvol *);
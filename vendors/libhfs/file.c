@@ -31,6 +31,7 @@
 # include "btree.h"
 # include "record.h"
 # include "volume.h"
+# include "block.h"
 
 /*
  * NAME:	file->init()
@@ -140,20 +141,16 @@ void f_getptrs(hfsfile *file, ExtDataRec **extrec,
 }
 
 /*
- * NAME:	file->doblock()
- * DESCRIPTION:	read or write a numbered block from a file
+ * NAME:	findextent()
+ * DESCRIPTION:	locate the extent holding an allocation block of a file
  */
-int f_doblock(hfsfile *file, unsigned long num, block *bp,
-	      int (*func)(hfsvol *, unsigned int, unsigned int, block *))
+static
+ExtDescriptor *findextent(hfsfile *file, unsigned int abnum,
+			  unsigned int *offs)
 {
-  unsigned int abnum;
-  unsigned int blnum;
   unsigned int fabn;
   int i;
 
-  abnum = num / file->vol->lpa;
-  blnum = num % file->vol->lpa;
-
   /* locate the appropriate extent record */
 
   fabn = file->fabn;
@@ -179,7 +176,10 @@ int f_doblock(hfsfile *file, unsigned long num, block *bp,
 	  n = file->ext[i].xdrNumABlks;
 
 	  if (abnum < n)
-	    return func(file->vol, file->ext[i].xdrStABN + abnum, blnum, bp);
+	    {
+	      *offs = abnum;
+	      return &file->ext[i];
+	    }
 
 	  fabn  += n;
 	  abnum -= n;
@@ -191,6 +191,59 @@ int f_doblock(hfsfile *file, unsigned long num, block *bp,
       file->fabn = fabn;
     }
 
+fail:
+  return 0;
+}
+
+/*
+ * NAME:	file->doblock()
+ * DESCRIPTION:	read or write a numbered block from a file
+ */
+int f_doblock(hfsfile *file, unsigned long num, block *bp,
+	      int (*func)(hfsvol *, unsigned int, unsigned int, block *))
+{
+  ExtDescriptor *ext;
+  unsigned int abnum;
+
+  ext = findextent(file, num / file->vol->lpa, &abnum);
+  if (ext == 0)
+    goto fail;
+
+  return func(file->vol, ext->xdrStABN + abnum, num % file->vol->lpa, bp);
+
+fail:
+  return -1;
+}
+
+/*
+ * NAME:	file->readblocks()
+ * DESCRIPTION:	read numbered blocks from a file, up to the end of the
+ *		extent holding the first one (bypassing cache); return the
+ *		number of blocks read or -1 (error)
+ */
+long f_readblocks(hfsfile *file, unsigned long num, block *bp,
+		  unsigned long count)
+{
+  hfsvol *vol = file->vol;
+  ExtDescriptor *ext;
+  unsigned int abnum, blnum;
+  unsigned long avail;
+
+  blnum = num % vol->lpa;
+
+  ext = findextent(file, num / vol->lpa, &abnum);
+  if (ext == 0)
+    goto fail;
+
+  avail = (unsigned long) (ext->xdrNumABlks - abnum) * vol->lpa - blnum;
+  if (count > avail)
+    count = avail;
+
+  if (b_readabs(vol, ext->xdrStABN + abnum, blnum, bp, count) == -1)
+    goto fail;
+
+  return count;
+
 fail:
   return -1;
 }
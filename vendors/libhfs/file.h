@@ -38,6 +38,8 @@ int f_doblock(hfsfile *, unsigned long, block *,
 	      (int (*)(hfsvol *, unsigned int, unsigned int, block *))  \
 	      b_writeab)
 
+long f_readblocks(hfsfile *, unsigned long, block *, unsigned long);
+
 int f_addextent(hfsfile *, ExtDescriptor *);
 long f_alloc(hfsfile *);
 
@@ -41,6 +41,7 @@
 const char *hfs_error = "no error";	/* static error string */
 
 hfsvol *hfs_mounts;			/* linked list of mounted volumes */
+unsigned long hfs_cachesz = HFS_CACHESZ;	/* cache size of new volumes */
 
 static
 hfsvol *curvol;				/* current volume */
@@ -91,6 +92,33 @@ fail:
   return -1;
 }
 
+/*
+ * NAME:	mountvol()
+ * DESCRIPTION:	mount an open volume and add it to the list of volumes
+ */
+static
+int mountvol(hfsvol *vol, int pnum)
+{
+  if (v_geometry(vol, pnum) == -1 ||
+      v_mount(vol) == -1)
+    goto fail;
+
+  /* add to linked list of volumes */
+
+  vol->prev = 0;
+  vol->next = hfs_mounts;
+
+  if (hfs_mounts)
+    hfs_mounts->prev = vol;
+
+  hfs_mounts = vol;
+
+  return 0;
+
+fail:
+  return -1;
+}
+
 /* High-Level Volume Routines ============================================== */
 
 /*
@@ -148,21 +176,47 @@ hfsvol *hfs_mount(const char *path, int pnum, int mode)
 
   /* mount the volume */
 
-  if (v_geometry(vol, pnum) == -1 ||
-      v_mount(vol) == -1)
+  if (mountvol(vol, pnum) == -1)
     goto fail;
 
-  /* add to linked list of volumes */
+done:
+  ++vol->refs;
+  curvol = vol;
 
-  vol->prev = 0;
-  vol->next = hfs_mounts;
+  return vol;
 
-  if (hfs_mounts)
-    hfs_mounts->prev = vol;
+fail:
+  if (vol)
+    {
+      v_close(vol);
+      FREE(vol);
+    }
 
-  hfs_mounts = vol;
+  return 0;
+}
+
+/*
+ * NAME:	hfs->mountmem()
+ * DESCRIPTION:	open an HFS volume image in memory (read only); return volume
+ *		descriptor or 0 (error)
+ */
+hfsvol *hfs_mountmem(const void *data, unsigned long size, int pnum)
+{
+  hfsvol *vol;
+
+  vol = ALLOC(hfsvol, 1);
+  if (vol == 0)
+    ERROR(ENOMEM, 0);
+
+  v_init(vol, HFS_MODE_RDONLY);
+  vol->flags |= HFS_VOL_READONLY;
+
+  /* the memory is used directly, it must outlive the volume */
+
+  if (v_openmem(vol, data, size) == -1 ||
+      mountvol(vol, pnum) == -1)
+    goto fail;
 
-done:
   ++vol->refs;
   curvol = vol;
 
@@ -383,6 +437,69 @@ fail:
   return -1;
 }
 
+/*
+ * NAME:	hfs->setcache()
+ * DESCRIPTION:	resize (or disable) the block cache of a volume
+ */
+int hfs_setcache(hfsvol *vol, unsigned long size)
+{
+  if (getvol(&vol) == -1)
+    goto fail;
+
+  if (vol->flags & HFS_VOL_USINGCACHE)
+    {
+      vol->flags &= ~HFS_VOL_USINGCACHE;
+
+      if (b_finish(vol) == -1)
+	goto fail;
+    }
+
+  if (size > 0)
+    {
+      if (b_init(vol, size) == -1)
+	goto fail;
+
+      vol->flags |= HFS_VOL_USINGCACHE;
+    }
+
+  return 0;
+
+fail:
+  return -1;
+}
+
+/*
+ * NAME:	hfs->setdefcache()
+ * DESCRIPTION:	set the block cache size of volumes mounted from now on
+ */
+void hfs_setdefcache(unsigned long size)
+{
+  hfs_cachesz = size;
+}
+
+/*
+ * NAME:	hfs->cachestat()
+ * DESCRIPTION:	return block cache statistics of a volume
+ */
+int hfs_cachestat(hfsvol *vol, hfscachestat *ent)
+{
+  const bcache *cache;
+
+  if (getvol(&vol) == -1)
+    goto fail;
+
+  cache = vol->cache;
+
+  ent->size   = cache ? cache->size   : 0;
+  ent->hits   = cache ? cache->hits   : 0;
+  ent->misses = cache ? cache->misses : 0;
+
+  return 0;
+
+fail:
+  return -1;
+}
+
 /* High-Level Directory Routines =========================================== */
 
 /*
@@ -487,7 +604,8 @@ hfsdir *hfs_opendir(hfsvol *vol, const char *path)
   if (dir == 0)
     ERROR(ENOMEM, 0);
 
-  dir->vol = vol;
+  dir->vol   = vol;
+  dir->flags = 0;
 
   if (*path == 0)
     {
@@ -529,6 +647,49 @@ fail:
   return 0;
 }
 
+/*
+ * NAME:	hfs->opencat()
+ * DESCRIPTION:	prepare to read every entry of a volume's catalog
+ */
+hfsdir *hfs_opencat(hfsvol *vol)
+{
+  hfsdir *dir = 0;
+
+  if (getvol(&vol) == -1)
+    goto fail;
+
+  dir = ALLOC(hfsdir, 1);
+  if (dir == 0)
+    ERROR(ENOMEM, 0);
+
+  dir->vol   = vol;
+  dir->dirid = HFS_CNID_ROOTPAR;
+  dir->flags = HFS_DIR_CATALOG;
+  dir->vptr  = 0;
+
+  /* start just before the first record of the first leaf node */
+
+  dir->n.bt         = &vol->cat;
+  dir->n.nnum       = 0;
+  dir->n.nd.ndFLink = vol->cat.hdr.bthFNode;
+  dir->n.nd.ndNRecs = 0;
+  dir->n.rnum       = 0;
+
+  dir->prev = 0;
+  dir->next = vol->dirs;
+
+  if (vol->dirs)
+    vol->dirs->prev = dir;
+
+  vol->dirs = dir;
+
+  return dir;
+
+fail:
+  FREE(dir);
+  return 0;
+}
+
 /*
  * NAME:	hfs->readdir()
  * DESCRIPTION:	return the next entry in the directory
@@ -593,7 +754,8 @@ int hfs_readdir(hfsdir *dir, hfsdirent *ent)
 
       r_unpackcatkey(ptr, &key);
 
-      if (key.ckrParID != dir->dirid)
+      if (key.ckrParID != dir->dirid &&
+	  ! (dir->flags & HFS_DIR_CATALOG))
 	{
 	  dir->n.rnum = -1;
 	  ERROR(ENOENT, "no more entries");
@@ -625,6 +787,43 @@ fail:
   return -1;
 }
 
+/*
+ * NAME:	hfs->getcatrec()
+ * DESCRIPTION:	save the catalog record of the file last read from a directory
+ */
+int hfs_getcatrec(hfsdir *dir, hfscatrec *rec)
+{
+  CatKeyRec key;
+  const byte *ptr, *end;
+
+  if (dir->dirid == 0 ||
+      dir->n.rnum < 0 || dir->n.rnum >= dir->n.nd.ndNRecs)
+    ERROR(ENOENT, "no current directory entry");
+
+  /* copy the record still held in the directory's node */
+
+  ptr = HFS_NODEREC(dir->n, dir->n.rnum);
+  end = dir->n.data + HFS_BLOCKSZ;
+
+  r_unpackcatkey(ptr, &key);
+  ptr = HFS_RECDATA(ptr);
+
+  if (ptr >= end || *ptr != cdrFilRec)
+    ERROR(EISDIR, 0);
+
+  if (end - ptr < HFS_CATRECSZ)
+    ERROR(EIO, "bad catalog record");
+
+  rec->parid = key.ckrParID;
+  strcpy(rec->name, key.ckrCName);
+  memcpy(rec->data, ptr, HFS_CATRECSZ);
+
+  return 0;
+
+fail:
+  return -1;
+}
+
 /*
  * NAME:	hfs->closedir()
  * DESCRIPTION:	stop reading a directory
@@ -768,6 +967,51 @@ fail:
   return 0;
 }
 
+/*
+ * NAME:	hfs->openrec()
+ * DESCRIPTION:	prepare a file for I/O from a saved catalog record
+ */
+hfsfile *hfs_openrec(hfsvol *vol, const hfscatrec *rec)
+{
+  hfsfile *file = 0;
+
+  if (getvol(&vol) == -1)
+    goto fail;
+
+  file = ALLOC(hfsfile, 1);
+  if (file == 0)
+    ERROR(ENOMEM, 0);
+
+  r_unpackcatdata(rec->data, &file->cat);
+
+  if (file->cat.cdrType != cdrFilRec)
+    ERROR(EISDIR, 0);
+
+  file->parid = rec->parid;
+  strcpy(file->name, rec->name);
+
+  /* package file handle for user */
+
+  file->vol   = vol;
+  file->flags = 0;
+
+  f_selectfork(file, fkData);
+
+  file->prev = 0;
+  file->next = vol->files;
+
+  if (vol->files)
+    vol->files->prev = file;
+
+  vol->files = file;
+
+  return file;
+
+fail:
+  FREE(file);
+  return 0;
+}
+
 /*
  * NAME:	hfs->setfork()
  * DESCRIPTION:	select file fork for I/O operations
@@ -821,8 +1065,16 @@ unsigned long hfs_read(hfsfile *file, void *buf, unsigned long len)
 
       if (offs == 0 && chunk == HFS_BLOCKSZ)
 	{
-	  if (f_getblock(file, bnum, (block *) ptr) == -1)
+	  long nblocks;
+
+	  /* read whole blocks one extent at a time */
+
+	  nblocks = f_readblocks(file, bnum, (block *) ptr,
+				 count >> HFS_BLOCKSZ_BITS);
+	  if (nblocks == -1)
 	    goto fail;
+
+	  chunk = nblocks << HFS_BLOCKSZ_BITS;
 	}
       else
 	{
@@ -55,6 +55,13 @@ typedef struct {
   unsigned long blessed;	/* CNID of MacOS System Folder */
 } hfsvolent;
 
+typedef struct {
+  unsigned long size;		/* number of cached blocks (0 if no cache) */
+
+  unsigned long hits;		/* number of block requests found in cache */
+  unsigned long misses;		/* number of block requests read or written */
+} hfscachestat;
+
 typedef struct {
   char name[HFS_MAX_FLEN + 1];	/* catalog name (MacOS Standard Roman) */
   int flags;			/* bit flags */
@@ -94,6 +101,15 @@ typedef struct {
   } u;
 } hfsdirent;
 
+# define HFS_CATRECSZ		102
+
+typedef struct {
+  unsigned long parid;		/* CNID of parent directory */
+  char name[HFS_MAX_FLEN + 1];	/* catalog name (MacOS Standard Roman) */
+  unsigned char data[HFS_CATRECSZ];
+				/* packed catalog file record */
+} hfscatrec;
+
 # define HFS_ISDIR		0x0001
 # define HFS_ISLOCKED		0x0002
 
@@ -136,6 +152,7 @@ extern const unsigned char hfs_charorder[];
 # define HFS_SEEK_END		2
 
 hfsvol *hfs_mount(const char *, int, int);
+hfsvol *hfs_mountmem(const void *, unsigned long, int);
 int hfs_flush(hfsvol *);
 void hfs_flushall(void);
 int hfs_umount(hfsvol *);
@@ -146,17 +163,24 @@ void hfs_setvol(hfsvol *);
 int hfs_vstat(hfsvol *, hfsvolent *);
 int hfs_vsetattr(hfsvol *, hfsvolent *);
 
+int hfs_setcache(hfsvol *, unsigned long);
+void hfs_setdefcache(unsigned long);
+int hfs_cachestat(hfsvol *, hfscachestat *);
+
 int hfs_chdir(hfsvol *, const char *);
 unsigned long hfs_getcwd(hfsvol *);
 int hfs_setcwd(hfsvol *, unsigned long);
 int hfs_dirinfo(hfsvol *, unsigned long *, char *);
 
 hfsdir *hfs_opendir(hfsvol *, const char *);
+hfsdir *hfs_opencat(hfsvol *);
 int hfs_readdir(hfsdir *, hfsdirent *);
+int hfs_getcatrec(hfsdir *, hfscatrec *);
 int hfs_closedir(hfsdir *);
 
 hfsfile *hfs_create(hfsvol *, const char *, const char *, const char *);
 hfsfile *hfs_open(hfsvol *, const char *);
+hfsfile *hfs_openrec(hfsvol *, const hfscatrec *);
 int hfs_setfork(hfsfile *, int);
 int hfs_getfork(hfsfile *);
 unsigned long hfs_read(hfsfile *, void *, unsigned long);
@@ -58,36 +58,45 @@ typedef byte block[HFS_BLOCKSZ];
 
 typedef struct _bucket_ {
   int flags;			/* bit flags */
-  unsigned int count;		/* number of times this block is requested */
 
   unsigned long bnum;		/* logical block number */
   block *data;			/* pointer to block contents */
 
-  struct _bucket_ *cnext;	/* next bucket in cache chain */
-  struct _bucket_ *cprev;	/* previous bucket in cache chain */
-
-  struct _bucket_ *hnext;	/* next bucket in hash chain */
-  struct _bucket_ **hprev;	/* previous bucket's pointer to this bucket */
+  struct _bucket_ *cnext;	/* next bucket in cache queue */
+  struct _bucket_ *cprev;	/* previous bucket in cache queue */
 } bucket;
 
 # define HFS_BUCKET_INUSE	0x01
 # define HFS_BUCKET_DIRTY	0x02
+# define HFS_BUCKET_HOT		0x04
 
-# define HFS_CACHESZ		128
-# define HFS_HASHSZ		32
+# define HFS_CACHESZ		4096
+# define HFS_CACHEMAX		(1UL << 21)
 # define HFS_BLOCKBUFSZ		16
 
 typedef struct {
   struct _hfsvol_ *vol;		/* volume to which cache belongs */
-  bucket *tail;			/* end of bucket chain */
+  unsigned int size;		/* number of buckets */
+
+  unsigned long hits;		/* number of cache hits */
+  unsigned long misses;		/* number of cache misses */
+
+  bucket idle;			/* queue of unused buckets */
+  bucket cold;			/* FIFO queue of blocks seen once (2Q A1in) */
+  bucket hot;			/* LRU queue of blocks seen again (2Q Am) */
+  unsigned int ncold;		/* number of buckets in cold queue */
+  unsigned int kin;		/* cold queue length before evicting from it */
 
-  unsigned int hits;		/* number of cache hits */
-  unsigned int misses;		/* number of cache misses */
+  unsigned long *ghost;		/* ring of blocks evicted from cold (2Q A1out) */
+  unsigned int gsize;		/* number of blocks remembered in ring */
+  unsigned int gnext;		/* next ring entry to overwrite */
 
-  bucket chain[HFS_CACHESZ];	/* cache bucket chain */
-  bucket *hash[HFS_HASHSZ];	/* hash table for bucket chain */
+  unsigned int *hash;		/* open-addressing table (index + 1 or 0) */
+  unsigned int hbits;		/* log2 of hash table size */
 
-  block pool[HFS_CACHESZ];	/* physical blocks in cache */
+  bucket *chain;		/* cache buckets */
+  bucket **list;		/* scratch array for sorting buckets */
+  block *pool;			/* physical blocks in cache */
 } bcache;
 
 # define HFS_MAP1SZ  256
@@ -159,6 +168,7 @@ typedef struct _node_ {
 struct _hfsdir_ {
   struct _hfsvol_ *vol;		/* associated volume */
   unsigned long dirid;		/* directory ID of interest (or 0) */
+  int flags;			/* bit flags */
 
   node n;			/* current B*-tree node */
   struct _hfsvol_ *vptr;	/* current volume pointer */
@@ -167,6 +177,8 @@ struct _hfsdir_ {
   struct _hfsdir_ *next;
 };
 
+# define HFS_DIR_CATALOG	0x01
+
 typedef void (*keyunpackfunc)(const byte *, void *);
 typedef int (*keycomparefunc)(const void *, const void *);
 
@@ -224,3 +236,4 @@ struct _hfsvol_ {
 # define HFS_VOL_OPT_MASK	0xff00
 
 extern hfsvol *hfs_mounts;
+extern unsigned long hfs_cachesz;
@@ -26,14 +26,22 @@
 # include <fcntl.h>
 # include <unistd.h>
 # include <errno.h>
+# include <stdlib.h>
+# include <string.h>
 # include <sys/stat.h>
+# include <sys/uio.h>
 
 # include "libhfs.h"
 # include "os.h"
 
-// Ignore warning on pointer-to-int and int-to-pinter conversions.
-#pragma GCC diagnostic ignored "-Wint-to-pointer-cast"
-#pragma GCC diagnostic ignored "-Wpointer-to-int-cast"
+/* a medium is either an open file or an image in memory (read only); it has
+   no seek pointer, so all transfers are positional */
+
+typedef struct {
+  int fd;			/* file descriptor (or -1) */
+  const byte *data;		/* image in memory (or 0) */
+  unsigned long size;		/* size of the image in memory (bytes) */
+} osmedium;
 
 
 /*
@@ -42,6 +50,7 @@
  */
 int os_open(void **priv, const char *path, int mode)
 {
+  osmedium *medium;
   int fd;
   struct flock lock;
 
@@ -72,7 +81,15 @@ int os_open(void **priv, const char *path, int mode)
       (errno == EACCES || errno == EAGAIN))
     ERROR(EAGAIN, "unable to obtain lock for medium");
 
-  *priv = (void *) fd;
+  medium = ALLOC(osmedium, 1);
+  if (medium == 0)
+    ERROR(ENOMEM, 0);
+
+  medium->fd   = fd;
+  medium->data = 0;
+  medium->size = 0;
+
+  *priv = medium;
 
   return 0;
 
@@ -83,17 +100,43 @@ fail:
   return -1;
 }
 
+/*
+ * NAME:	os->openmem()
+ * DESCRIPTION:	open a new read-only descriptor on an image in memory
+ */
+int os_openmem(void **priv, const void *data, unsigned long size)
+{
+  osmedium *medium;
+
+  medium = ALLOC(osmedium, 1);
+  if (medium == 0)
+    ERROR(ENOMEM, 0);
+
+  medium->fd   = -1;
+  medium->data = (const byte *) data;
+  medium->size = size;
+
+  *priv = medium;
+
+  return 0;
+
+fail:
+  return -1;
+}
+
 /*
  * NAME:	os->close()
  * DESCRIPTION:	close an open descriptor
  */
 int os_close(void **priv)
 {
-  int fd = (int) *priv;
+  osmedium *medium = *priv;
+  int fd = medium->fd;
 
-  *priv = (void *) -1;
+  *priv = 0;
+  FREE(medium);
 
-  if (close(fd) == -1)
+  if (fd != -1 && close(fd) == -1)
     ERROR(errno, "error closing medium");
 
   return 0;
@@ -108,10 +151,13 @@ fail:
  */
 int os_same(void **priv, const char *path)
 {
-  int fd = (int) *priv;
+  osmedium *medium = *priv;
   struct stat fdev, dev;
 
-  if (fstat(fd, &fdev) == -1 ||
+  if (medium->fd == -1)
+    return 0;
+
+  if (fstat(medium->fd, &fdev) == -1 ||
       stat(path, &dev) == -1)
     ERROR(errno, "can't get path information");
 
@@ -123,21 +169,18 @@ fail:
 }
 
 /*
- * NAME:	os->seek()
- * DESCRIPTION:	set a descriptor's seek pointer (offset in blocks)
+ * NAME:	os->size()
+ * DESCRIPTION:	return the number of blocks in an open descriptor
  */
-unsigned long os_seek(void **priv, unsigned long offset)
+unsigned long os_size(void **priv)
 {
-  int fd = (int) *priv;
+  osmedium *medium = *priv;
   off_t result;
 
-  /* offset == -1 special; seek to last block of device */
-
-  if (offset == (unsigned long) -1)
-    result = lseek(fd, 0, SEEK_END);
-  else
-    result = lseek(fd, offset << HFS_BLOCKSZ_BITS, SEEK_SET);
+  if (medium->fd == -1)
+    return medium->size >> HFS_BLOCKSZ_BITS;
 
+  result = lseek(medium->fd, 0, SEEK_END);
   if (result == -1)
     ERROR(errno, "error seeking medium");
 
@@ -147,21 +190,59 @@ fail:
   return -1;
 }
 
+/*
+ * NAME:	memblocks()
+ * DESCRIPTION:	return how many blocks can be read from an image in memory
+ */
+static
+unsigned long memblocks(const osmedium *medium, unsigned long bnum,
+			unsigned long len)
+{
+  unsigned long nblocks = medium->size >> HFS_BLOCKSZ_BITS;
+
+  if (bnum >= nblocks)
+    return 0;
+
+  return (len < nblocks - bnum) ? len : nblocks - bnum;
+}
+
 /*
  * NAME:	os->read()
- * DESCRIPTION:	read blocks from an open descriptor
+ * DESCRIPTION:	read blocks from an open descriptor (offset in blocks)
  */
-unsigned long os_read(void **priv, void *buf, unsigned long len)
+unsigned long os_read(void **priv, unsigned long bnum, void *buf,
+		      unsigned long len)
 {
-  int fd = (int) *priv;
+  osmedium *medium = *priv;
+  off_t offset = (off_t) bnum << HFS_BLOCKSZ_BITS;
+  size_t size = len << HFS_BLOCKSZ_BITS, done = 0;
   ssize_t result;
 
-  result = read(fd, buf, len << HFS_BLOCKSZ_BITS);
+  if (medium->fd == -1)
+    {
+      len = memblocks(medium, bnum, len);
+      if (len > 0)
+	memcpy(buf, medium->data + offset, len << HFS_BLOCKSZ_BITS);
 
-  if (result == -1)
-    ERROR(errno, "error reading from medium");
+      return len;
+    }
 
-  return (unsigned long) result >> HFS_BLOCKSZ_BITS;
+  /* large transfers may be split by the system */
+
+  while (done < size)
+    {
+      result = pread(medium->fd, (byte *) buf + done, size - done,
+		     offset + done);
+
+      if (result == -1)
+	ERROR(errno, "error reading from medium");
+      else if (result == 0)
+	break;
+
+      done += result;
+    }
+
+  return done >> HFS_BLOCKSZ_BITS;
 
 fail:
   return -1;
@@ -169,19 +250,192 @@ fail:
 
 /*
  * NAME:	os->write()
- * DESCRIPTION:	write blocks to an open descriptor
+ * DESCRIPTION:	write blocks to an open descriptor (offset in blocks)
  */
-unsigned long os_write(void **priv, const void *buf, unsigned long len)
+unsigned long os_write(void **priv, unsigned long bnum, const void *buf,
+		       unsigned long len)
 {
-  int fd = (int) *priv;
+  osmedium *medium = *priv;
+  off_t offset = (off_t) bnum << HFS_BLOCKSZ_BITS;
+  size_t size = len << HFS_BLOCKSZ_BITS, done = 0;
   ssize_t result;
 
-  result = write(fd, buf, len << HFS_BLOCKSZ_BITS);
+  if (medium->fd == -1)
+    ERROR(EROFS, "medium in memory is read-only");
 
-  if (result == -1)
-    ERROR(errno, "error writing to medium");
+  while (done < size)
+    {
+      result = pwrite(medium->fd, (const byte *) buf + done, size - done,
+		      offset + done);
 
-  return (unsigned long) result >> HFS_BLOCKSZ_BITS;
+      if (result == -1)
+	ERROR(errno, "error writing to medium");
+      else if (result == 0)
+	break;
+
+      done += result;
+    }
+
+  return done >> HFS_BLOCKSZ_BITS;
+
+fail:
+  return -1;
+}
+
+# if defined(HAVE_PREADV) || defined(HAVE_PWRITEV)
+/*
+ * NAME:	skipiov()
+ * DESCRIPTION:	advance a vector of buffers past the bytes already transferred
+ */
+static
+void skipiov(struct iovec **iov, int *count, size_t done)
+{
+  while (*count > 0 && done >= (*iov)->iov_len)
+    {
+      done -= (*iov)->iov_len;
+      ++*iov, --*count;
+    }
+
+  if (*count > 0)
+    {
+      (*iov)->iov_base = (byte *) (*iov)->iov_base + done;
+      (*iov)->iov_len -= done;
+    }
+}
+# endif
+
+/*
+ * NAME:	os->readv()
+ * DESCRIPTION:	read consecutive blocks into scattered buffers
+ */
+unsigned long os_readv(void **priv, unsigned long bnum, block *const *bufs,
+		       unsigned int len)
+{
+  osmedium *medium = *priv;
+  unsigned int i;
+
+  if (medium->fd == -1)
+    {
+      len = memblocks(medium, bnum, len);
+      for (i = 0; i < len; ++i)
+	memcpy(bufs[i], medium->data + ((bnum + i) << HFS_BLOCKSZ_BITS),
+	       HFS_BLOCKSZ);
+
+      return len;
+    }
+
+# ifdef HAVE_PREADV
+  {
+    struct iovec iov[HFS_BLOCKBUFSZ], *vec = iov;
+    off_t offset = (off_t) bnum << HFS_BLOCKSZ_BITS;
+    int count = len;
+    size_t done = 0;
+    ssize_t result;
+
+    if (len > HFS_BLOCKBUFSZ)
+      ERROR(EINVAL, "too many blocks for one transfer");
+
+    for (i = 0; i < len; ++i)
+      {
+	iov[i].iov_base = bufs[i];
+	iov[i].iov_len  = HFS_BLOCKSZ;
+      }
+
+    /* short transfers are resumed where they stopped */
+
+    while (count > 0)
+      {
+	result = preadv(medium->fd, vec, count, offset + done);
+
+	if (result == -1)
+	  ERROR(errno, "error reading from medium");
+	else if (result == 0)
+	  break;
+
+	done += result;
+	skipiov(&vec, &count, result);
+      }
+
+    return done >> HFS_BLOCKSZ_BITS;
+  }
+# else
+  for (i = 0; i < len; ++i)
+    {
+      unsigned long nblocks = os_read(priv, bnum + i, bufs[i], 1);
+
+      if (nblocks == (unsigned long) -1)
+	goto fail;
+      else if (nblocks == 0)
+	break;
+    }
+
+  return i;
+# endif
+
+fail:
+  return -1;
+}
+
+/*
+ * NAME:	os->writev()
+ * DESCRIPTION:	write consecutive blocks from scattered buffers
+ */
+unsigned long os_writev(void **priv, unsigned long bnum,
+			const block *const *bufs, unsigned int len)
+{
+  osmedium *medium = *priv;
+  unsigned int i;
+
+  if (medium->fd == -1)
+    ERROR(EROFS, "medium in memory is read-only");
+
+# ifdef HAVE_PWRITEV
+  {
+    struct iovec iov[HFS_BLOCKBUFSZ], *vec = iov;
+    off_t offset = (off_t) bnum << HFS_BLOCKSZ_BITS;
+    int count = len;
+    size_t done = 0;
+    ssize_t result;
+
+    if (len > HFS_BLOCKBUFSZ)
+      ERROR(EINVAL, "too many blocks for one transfer");
+
+    for (i = 0; i < len; ++i)
+      {
+	iov[i].iov_base = (void *) bufs[i];
+	iov[i].iov_len  = HFS_BLOCKSZ;
+      }
+
+    /* short transfers are resumed where they stopped */
+
+    while (count > 0)
+      {
+	result = pwritev(medium->fd, vec, count, offset + done);
+
+	if (result == -1)
+	  ERROR(errno, "error writing to medium");
+	else if (result == 0)
+	  break;
+
+	done += result;
+	skipiov(&vec, &count, result);
+      }
+
+    return done >> HFS_BLOCKSZ_BITS;
+  }
+# else
+  for (i = 0; i < len; ++i)
+    {
+      unsigned long nblocks = os_write(priv, bnum + i, bufs[i], 1);
+
+      if (nblocks == (unsigned long) -1)
+	goto fail;
+      else if (nblocks == 0)
+	break;
+    }
+
+  return i;
+# endif
 
 fail:
   return -1;
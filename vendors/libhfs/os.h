@@ -20,10 +20,16 @@
  */
 
 int os_open(void **, const char *, int);
+int os_openmem(void **, const void *, unsigned long);
 int os_close(void **);
 
 int os_same(void **, const char *);
 
-unsigned long os_seek(void **, unsigned long);
-unsigned long os_read(void **, void *, unsigned long);
-unsigned long os_write(void **, const void *, unsigned long);
+unsigned long os_size(void **);
+
+unsigned long os_read(void **, unsigned long, void *, unsigned long);
+unsigned long os_write(void **, unsigned long, const void *, unsigned long);
+
+unsigned long os_readv(void **, unsigned long, block *const *, unsigned int);
+unsigned long os_writev(void **, unsigned long, const block *const *,
+			unsigned int);
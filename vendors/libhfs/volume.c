@@ -89,6 +89,22 @@ void v_init(hfsvol *vol, int flags)
   vol->next       = 0;
 }
 
+/*
+ * NAME:	openedvol()
+ * DESCRIPTION:	finish opening a volume once its source is open
+ */
+static
+void openedvol(hfsvol *vol)
+{
+  vol->flags |= HFS_VOL_OPEN;
+
+  /* initialize volume block cache (OK to fail) */
+
+  if (! (vol->flags & HFS_OPT_NOCACHE) && hfs_cachesz > 0 &&
+      b_init(vol, hfs_cachesz) != -1)
+    vol->flags |= HFS_VOL_USINGCACHE;
+}
+
 /*
  * NAME:	vol->open()
  * DESCRIPTION:	open volume source and lock against concurrent updates
@@ -101,13 +117,27 @@ int v_open(hfsvol *vol, const char *path, int mode)
   if (os_open(&vol->priv, path, mode) == -1)
     goto fail;
 
-  vol->flags |= HFS_VOL_OPEN;
+  openedvol(vol);
 
-  /* initialize volume block cache (OK to fail) */
+  return 0;
 
-  if (! (vol->flags & HFS_OPT_NOCACHE) &&
-      b_init(vol) != -1)
-    vol->flags |= HFS_VOL_USINGCACHE;
+fail:
+  return -1;
+}
+
+/*
+ * NAME:	vol->openmem()
+ * DESCRIPTION:	open a volume image in memory (read only)
+ */
+int v_openmem(hfsvol *vol, const void *data, unsigned long size)
+{
+  if (vol->flags & HFS_VOL_OPEN)
+    ERROR(EINVAL, "volume already open");
+
+  if (os_openmem(&vol->priv, data, size) == -1)
+    goto fail;
+
+  openedvol(vol);
 
   return 0;
 
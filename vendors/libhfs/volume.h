@@ -22,6 +22,7 @@
 void v_init(hfsvol *, int);
 
 int v_open(hfsvol *, const char *, int);
+int v_openmem(hfsvol *, const void *, unsigned long);
 int v_flush(hfsvol *);
 int v_close(hfsvol *);
 